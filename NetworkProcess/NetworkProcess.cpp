@@ -197,7 +197,14 @@ void NetworkProcess::didClose(IPC::Connection&)
 
     // Make sure we flush all cookies to disk before exiting.
     platformSyncAllCookies([this] {
-        stopRunLoop();
+        if (!m_cache) {
+            stopRunLoop();
+            return;
+        }
+        // Persisting the cache contents lets the next launch skip traversing the whole cache.
+        m_cache->writeContentsSnapshot(NetworkCache::Storage::SnapshotType::Final, [this] {
+            stopRunLoop();
+        });
     });
 }
 
@@ -226,6 +233,9 @@ void NetworkProcess::lowMemoryHandler(Critical critical)
     if (m_suppressMemoryPressureHandler)
         return;
 
+    if (m_cache)
+        m_cache->handleMemoryPressure(critical == Critical::Yes);
+
     WTF::releaseFastMallocFreeMemory();
 }
 
@@ -730,8 +740,10 @@ void NetworkProcess::setCacheModel(uint32_t cm)
     if (m_diskCacheSizeOverride >= 0)
         urlCacheDiskCapacity = m_diskCacheSizeOverride;
 
-    if (m_cache)
+    if (m_cache) {
         m_cache->setCapacity(urlCacheDiskCapacity);
+        m_cache->setMemoryCapacity(urlCacheMemoryCapacity);
+    }
 }
 
 void NetworkProcess::setCanHandleHTTPSServerTrustEvaluation(bool value)
@@ -824,6 +836,8 @@ void NetworkProcess::actualPrepareToSuspend(ShouldAcknowledgeWhenReadyToSuspend
 
     platformPrepareToSuspend([delayedTaskCounter] { });
     platformSyncAllCookies([delayedTaskCounter] { });
+    if (m_cache)
+        m_cache->writeContentsSnapshot(NetworkCache::Storage::SnapshotType::Checkpoint, [delayedTaskCounter] { });
 
     for (auto& connection : m_webProcessConnections)
         connection->cleanupForSuspension([delayedTaskCounter] { });
@@ -36,6 +36,7 @@
 #include <pal/SessionID.h>
 #include <wtf/MainThread.h>
 #include <wtf/NeverDestroyed.h>
+#include <wtf/StdLibExtras.h>
 #include <wtf/UUID.h>
 #include <wtf/persistence/PersistentCoders.h>
 #include <wtf/persistence/PersistentDecoder.h>
@@ -95,6 +96,18 @@ static inline void updateVaryInformation(RecordInformation& recordInformation, c
         recordInformation.varyHeaders = { };
 }
 
+void RecordsDigest::add(const Key& key, double insertionTime, uint64_t size)
+{
+    uint64_t keyHash;
+    static_assert(sizeof(keyHash) <= std::tuple_size<Key::HashType>::value, "Key hash size");
+    memcpy(&keyHash, key.hash().data(), sizeof(keyHash));
+
+    ++count;
+    totalSize += size;
+    // Updating a record in place keeps its key, so mix in what the update changes.
+    combinedRecordHash ^= keyHash ^ ((bitwise_cast<uint64_t>(insertionTime) + size) * 0x9E3779B97F4A7C15ull);
+}
+
 RecordInformation Cache::toRecordInformation(const Record& record)
 {
     Key key { "record"_s, m_uniqueName, { }, createCanonicalUUIDString(), m_caches.salt() };
@@ -121,6 +134,9 @@ void Cache::dispose()
 
 void Cache::clearMemoryRepresentation()
 {
+    if (m_hasPendingIndexWrite)
+        writeIndex();
+
     m_records = { };
     m_nextRecordIdentifier = 0;
     m_state = State::Uninitialized;
@@ -157,6 +173,71 @@ static TraversalResult isolatedCopy(TraversalResult&& result)
     return TraversalResult { result.cacheIdentifier, WTFMove(isolatedRecords), WTFMove(result.failedRecords) };
 }
 
+static Data encodeIndex(const HashMap<String, Vector<RecordInformation>>& records, RecordsDigest& digest)
+{
+    Vector<const RecordInformation*> sortedRecords;
+    for (auto& sameURLRecords : records.values()) {
+        for (auto& record : sameURLRecords)
+            sortedRecords.append(&record);
+    }
+    std::sort(sortedRecords.begin(), sortedRecords.end(), [](auto* a, auto* b) {
+        return a->identifier < b->identifier;
+    });
+
+    WTF::Persistence::Encoder encoder;
+    encoder << static_cast<uint64_t>(sortedRecords.size());
+    for (auto* record : sortedRecords) {
+        encoder << record->key;
+        encoder << record->insertionTime;
+        encoder << record->size;
+        encoder << record->url.string();
+        encoder << record->hasVaryStar;
+        encoder << record->varyHeaders;
+
+        digest.add(record->key, record->insertionTime, record->size);
+    }
+    encoder.encodeChecksum();
+
+    return Data { encoder.buffer(), encoder.bufferSize() };
+}
+
+static std::optional<HashMap<String, Vector<RecordInformation>>> decodeIndex(const Data& data, RecordsDigest& digest)
+{
+    if (data.isNull())
+        return std::nullopt;
+
+    WTF::Persistence::Decoder decoder(data.data(), data.size());
+    uint64_t count;
+    if (!decoder.decode(count))
+        return std::nullopt;
+
+    HashMap<String, Vector<RecordInformation>> records;
+    for (uint64_t index = 0; index < count; ++index) {
+        RecordInformation record;
+        if (!decoder.decode(record.key))
+            return std::nullopt;
+        if (!decoder.decode(record.insertionTime))
+            return std::nullopt;
+        if (!decoder.decode(record.size))
+            return std::nullopt;
+        String url;
+        if (!decoder.decode(url))
+            return std::nullopt;
+        record.url = URL { URL { }, url };
+        if (!decoder.decode(record.hasVaryStar))
+            return std::nullopt;
+        if (!decoder.decode(record.varyHeaders))
+            return std::nullopt;
+
+        digest.add(record.key, record.insertionTime, record.size);
+        records.ensure(computeKeyURL(record.url), [] { return Vector<RecordInformation> { }; }).iterator->value.append(WTFMove(record));
+    }
+    if (!decoder.verifyChecksum())
+        return std::nullopt;
+
+    return WTFMove(records);
+}
+
 void Cache::open(CompletionCallback&& callback)
 {
     if (m_state == State::Open) {
@@ -168,6 +249,28 @@ void Cache::open(CompletionCallback&& callback)
         return;
     }
     m_state = State::Opening;
+
+    m_caches.readIndex(*this, [caches = makeRef(m_caches), identifier = m_identifier, callback = WTFMove(callback)](const Data& data) mutable {
+        auto* cache = caches->find(identifier);
+        if (!cache) {
+            callback(Error::Internal);
+            return;
+        }
+
+        RecordsDigest digest;
+        auto records = decodeIndex(data, digest);
+        if (!records || !caches->isIndexUpToDate(*cache, digest)) {
+            cache->readRecordsList(WTFMove(callback));
+            return;
+        }
+
+        cache->m_records = WTFMove(records.value());
+        cache->finishOpening(WTFMove(callback), std::nullopt);
+    });
+}
+
+void Cache::readRecordsList(CompletionCallback&& callback)
+{
     TraversalResult traversalResult { m_identifier, { }, { } };
     m_caches.readRecordsList(*this, [caches = makeRef(m_caches), callback = WTFMove(callback), traversalResult = WTFMove(traversalResult)](const auto* storageRecord, const auto&) mutable {
         if (!storageRecord) {
@@ -181,6 +284,8 @@ void Cache::open(CompletionCallback&& callback)
                     return;
                 }
                 cache->m_records = WTFMove(traversalResult.records);
+                // Let the next opening skip the traversal.
+                cache->scheduleIndexWrite();
                 cache->finishOpening(WTFMove(callback), std::nullopt);
             });
             return;
@@ -398,6 +503,7 @@ void Cache::storeRecords(Vector<Record>&& records, RecordIdentifiersCallback&& c
             updateRecordToDisk(existingRecord, WTFMove(record), taskCounter.copyRef());
         }
     }
+    scheduleIndexWrite();
 }
 
 void Cache::put(Vector<Record>&& records, RecordIdentifiersCallback&& callback)
@@ -453,6 +559,7 @@ void Cache::remove(WebCore::ResourceRequest&& request, WebCore::CacheQueryOption
             this->removeRecordFromDisk(item);
         return shouldRemove;
     });
+    scheduleIndexWrite();
 
     callback(WTFMove(recordIdentifiers));
 }
@@ -473,6 +580,7 @@ void Cache::removeFromRecordList(const Vector<uint64_t>& recordIdentifiers)
             });
         });
     }
+    scheduleIndexWrite();
 }
 
 void Cache::writeRecordToDisk(const RecordInformation& recordInformation, Record&& record, Ref<AsynchronousPutTaskCounter>&& taskCounter, uint64_t previousRecordSize)
@@ -512,6 +620,7 @@ void Cache::updateRecordToDisk(RecordInformation& existingRecord, Record&& recor
         record.referrer = WTFMove(recordFromDisk.referrer);
 
         updateVaryInformation(recordInfo, record.request, record.response);
+        cache->scheduleIndexWrite();
 
         cache->writeRecordToDisk(recordInfo, WTFMove(record), WTFMove(taskCounter), previousSize);
     });
@@ -527,6 +636,36 @@ void Cache::removeRecordFromDisk(const RecordInformation& record)
     m_caches.removeRecord(record);
 }
 
+void Cache::scheduleIndexWrite()
+{
+    // The index no longer matches the records on disk until the new one is written.
+    m_caches.invalidateIndex(*this);
+
+    if (m_hasPendingIndexWrite)
+        return;
+    m_hasPendingIndexWrite = true;
+
+    // Coalesce the changes made by a single put or remove.
+    RunLoop::main().dispatch([caches = makeRef(m_caches), identifier = m_identifier] {
+        auto* cache = caches->find(identifier);
+        if (!cache || !cache->m_hasPendingIndexWrite)
+            return;
+        cache->writeIndex();
+    });
+}
+
+void Cache::writeIndex()
+{
+    ASSERT(m_hasPendingIndexWrite);
+    m_hasPendingIndexWrite = false;
+
+    if (m_state != State::Open)
+        return;
+    RecordsDigest digest;
+    auto data = encodeIndex(m_records, digest);
+    m_caches.writeIndex(*this, WTFMove(data), digest);
+}
+
 Storage::Record Cache::encode(const RecordInformation& recordInformation, const Record& record)
 {
     WTF::Persistence::Encoder encoder;
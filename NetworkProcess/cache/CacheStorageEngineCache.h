@@ -50,6 +50,18 @@ struct RecordInformation {
     HashMap<String, String> varyHeaders;
 };
 
+// Summarizes the records of a cache, to check that a persisted index matches the records on disk.
+struct RecordsDigest {
+    void add(const NetworkCache::Key&, double insertionTime, uint64_t size);
+
+    bool operator==(const RecordsDigest& other) const { return count == other.count && totalSize == other.totalSize && combinedRecordHash == other.combinedRecordHash; }
+    bool operator!=(const RecordsDigest& other) const { return !(*this == other); }
+
+    uint64_t count { 0 };
+    uint64_t totalSize { 0 };
+    uint64_t combinedRecordHash { 0 };
+};
+
 class AsynchronousPutTaskCounter;
 class ReadRecordTaskCounter;
 
@@ -106,6 +118,8 @@ private:
     void retrieveRecord(const RecordInformation&, Ref<ReadRecordTaskCounter>&&);
 
     void readRecordsList(WebCore::DOMCacheEngine::CompletionCallback&&);
+    void scheduleIndexWrite();
+    void writeIndex();
     void writeRecordToDisk(const RecordInformation&, WebCore::DOMCacheEngine::Record&&, Ref<AsynchronousPutTaskCounter>&&, uint64_t previousRecordSize);
     void updateRecordToDisk(RecordInformation&, WebCore::DOMCacheEngine::Record&&, Ref<AsynchronousPutTaskCounter>&&);
     void removeRecordFromDisk(const RecordInformation&);
@@ -119,6 +133,7 @@ private:
     String m_uniqueName;
     HashMap<String, Vector<RecordInformation>> m_records;
     uint64_t m_nextRecordIdentifier { 0 };
+    bool m_hasPendingIndexWrite { false };
     Vector<WebCore::DOMCacheEngine::CompletionCallback> m_pendingOpeningCallbacks;
 };
 
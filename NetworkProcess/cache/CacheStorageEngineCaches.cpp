@@ -50,6 +50,11 @@ static inline String cachesOriginFilename(const String& cachesRootPath)
     return WebCore::FileSystem::pathByAppendingComponent(cachesRootPath, "origin"_s);
 }
 
+static inline String cacheIndexFilename(const String& cachesRootPath, const String& cacheUniqueName)
+{
+    return WebCore::FileSystem::pathByAppendingComponent(cachesRootPath, "index-" + cacheUniqueName);
+}
+
 Caches::~Caches()
 {
     ASSERT(m_pendingWritingCachesToDiskCallbacks.isEmpty());
@@ -186,7 +191,14 @@ void Caches::initializeSize()
         return;
     }
 
+    if (auto size = sizeFromRecordsDigests()) {
+        didInitializeSize(*size);
+        return;
+    }
+
     uint64_t size = 0;
+    m_recordsDigests.clear();
+    m_recordsDigestsCoverAllRecords = false;
     m_storage->traverse({ }, 0, [protectedThis = makeRef(*this), this, protectedStorage = makeRef(*m_storage), size](const auto* storage, const auto& information) mutable {
         if (!storage) {
             if (m_pendingInitializationCallbacks.isEmpty()) {
@@ -194,20 +206,55 @@ void Caches::initializeSize()
                 m_storage = nullptr;
                 return;
             }
-            m_size = size;
-            m_isInitialized = true;
-            auto pendingCallbacks = WTFMove(m_pendingInitializationCallbacks);
-            for (auto& callback : pendingCallbacks)
-                callback(std::nullopt);
+            // Caches without records on disk match an empty index.
+            for (auto& cache : m_caches)
+                m_recordsDigests.add(cache.uniqueName(), RecordsDigest { });
+            m_recordsDigestsCoverAllRecords = true;
 
+            didInitializeSize(size);
             return;
         }
+
+        // Records that fail to decode still count so that the index doesn't match and opening removes them.
         auto decoded = Cache::decodeRecordHeader(*storage);
+        auto& digest = m_recordsDigests.ensure(storage->key.type(), [] { return RecordsDigest { }; }).iterator->value;
+        digest.add(storage->key, decoded ? decoded->insertionTime : 0, decoded ? decoded->size : 0);
+
         if (decoded)
             size += decoded->size;
     });
 }
 
+void Caches::didInitializeSize(uint64_t size)
+{
+    m_size = size;
+    m_isInitialized = true;
+    auto pendingCallbacks = WTFMove(m_pendingInitializationCallbacks);
+    for (auto& callback : pendingCallbacks)
+        callback(std::nullopt);
+}
+
+std::optional<uint64_t> Caches::sizeFromRecordsDigests() const
+{
+    if (!m_recordsDigestsCoverAllRecords)
+        return std::nullopt;
+
+    // A cache without a digest is being changed or failed to write its index.
+    for (auto& cache : m_caches) {
+        if (!m_recordsDigests.contains(cache.uniqueName()))
+            return std::nullopt;
+    }
+    for (auto& cache : m_removedCaches) {
+        if (!m_recordsDigests.contains(cache.uniqueName()))
+            return std::nullopt;
+    }
+
+    uint64_t size = 0;
+    for (auto& digest : m_recordsDigests.values())
+        size += digest.totalSize;
+    return size;
+}
+
 void Caches::detach()
 {
     m_engine = nullptr;
@@ -228,8 +275,15 @@ void Caches::clear(CompletionHandler<void()>&& completionHandler)
     for (auto& callback : pendingCallbacks)
         callback(Error::Internal);
 
-    if (m_engine)
+    m_recordsDigests.clear();
+    m_recordsDigestsCoverAllRecords = false;
+    m_pendingIndexWrites.clear();
+
+    if (m_engine) {
         m_engine->removeFile(cachesListFilename(m_rootPath));
+        for (auto& cache : m_caches)
+            m_engine->removeFile(cacheIndexFilename(m_rootPath, cache.uniqueName()));
+    }
     if (m_storage) {
         m_storage->clear(String { }, -WallTime::infinity(), [protectedThis = makeRef(*this), completionHandler = WTFMove(completionHandler)]() mutable {
             ASSERT(RunLoop::isMain());
@@ -343,6 +397,9 @@ void Caches::dispose(Cache& cache)
     if (position != notFound) {
         if (m_storage)
             m_storage->remove(cache.keys(), { });
+        invalidateIndex(cache);
+        if (m_engine)
+            m_engine->removeFile(cacheIndexFilename(m_rootPath, cache.uniqueName()));
 
         m_removedCaches.remove(position);
         return;
@@ -545,6 +602,61 @@ void Caches::removeCacheEntry(const NetworkCache::Key& key)
     m_storage->remove(key);
 }
 
+void Caches::readIndex(const Cache& cache, WTF::CompletionHandler<void(const Data&)>&& callback)
+{
+    ASSERT(m_isInitialized);
+
+    if (!shouldPersist() || !m_engine) {
+        callback(Data { });
+        return;
+    }
+
+    m_engine->readFile(cacheIndexFilename(m_rootPath, cache.uniqueName()), [callback = WTFMove(callback)](const Data& data, int error) mutable {
+        callback(error ? Data { } : data);
+    });
+}
+
+void Caches::writeIndex(const Cache& cache, Data&& data, const RecordsDigest& digest)
+{
+    ASSERT(m_isInitialized);
+
+    if (!shouldPersist() || !m_engine)
+        return;
+
+    // Removed caches are about to lose their records.
+    if (m_caches.findMatching([&](const auto& item) { return item.identifier() == cache.identifier(); }) == notFound)
+        return;
+
+    auto writeIdentifier = ++m_lastIndexWriteIdentifier;
+    m_pendingIndexWrites.set(cache.uniqueName(), writeIdentifier);
+
+    m_engine->writeFile(cacheIndexFilename(m_rootPath, cache.uniqueName()), WTFMove(data), [this, protectedThis = makeRef(*this), uniqueName = cache.uniqueName(), writeIdentifier, digest](std::optional<Error>&& error) {
+        // A later change made this write stale.
+        if (m_pendingIndexWrites.get(uniqueName) != writeIdentifier)
+            return;
+        m_pendingIndexWrites.remove(uniqueName);
+
+        if (error) {
+            if (m_engine)
+                m_engine->removeFile(cacheIndexFilename(m_rootPath, uniqueName));
+            return;
+        }
+        m_recordsDigests.set(uniqueName, digest);
+    });
+}
+
+void Caches::invalidateIndex(const Cache& cache)
+{
+    m_recordsDigests.remove(cache.uniqueName());
+    m_pendingIndexWrites.remove(cache.uniqueName());
+}
+
+bool Caches::isIndexUpToDate(const Cache& cache, const RecordsDigest& digest) const
+{
+    auto iterator = m_recordsDigests.find(cache.uniqueName());
+    return iterator != m_recordsDigests.end() && iterator->value == digest;
+}
+
 void Caches::clearMemoryRepresentation()
 {
     if (!m_isInitialized) {
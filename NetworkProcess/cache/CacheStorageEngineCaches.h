@@ -30,6 +30,7 @@
 #include <WebCore/ClientOrigin.h>
 #include <wtf/CompletionHandler.h>
 #include <wtf/Deque.h>
+#include <wtf/HashSet.h>
 
 namespace WebKit {
 
@@ -67,6 +68,11 @@ public:
     void removeCacheEntry(const NetworkCache::Key&);
     void removeRecord(const RecordInformation&);
 
+    void readIndex(const Cache&, WTF::CompletionHandler<void(const NetworkCache::Data&)>&&);
+    void writeIndex(const Cache&, NetworkCache::Data&&, const RecordsDigest&);
+    void invalidateIndex(const Cache&);
+    bool isIndexUpToDate(const Cache&, const RecordsDigest&) const;
+
     const NetworkCache::Salt& salt() const;
     const WebCore::ClientOrigin& origin() const { return m_origin; }
 
@@ -81,6 +87,8 @@ private:
     Caches(Engine&, WebCore::ClientOrigin&&, String&& rootPath, uint64_t quota);
 
     void initializeSize();
+    void didInitializeSize(uint64_t);
+    std::optional<uint64_t> sizeFromRecordsDigests() const;
     void readCachesFromDisk(WTF::Function<void(Expected<Vector<Cache>, WebCore::DOMCacheEngine::Error>&&)>&&);
     void writeCachesToDisk(WebCore::DOMCacheEngine::CompletionCallback&&);
 
@@ -104,6 +112,14 @@ private:
     Vector<Cache> m_removedCaches;
     RefPtr<NetworkCache::Storage> m_storage;
     HashMap<NetworkCache::Key, WebCore::DOMCacheEngine::Record> m_volatileStorage;
+    // Digests of the records on disk, keyed by cache unique name. They come from the initialization traversal
+    // or from the last index we wrote, and are dropped while a cache's index is being invalidated.
+    // They are kept across clearMemoryRepresentation() so that initializing again doesn't need a traversal.
+    HashMap<String, RecordsDigest> m_recordsDigests;
+    // Whether m_recordsDigests was filled by a traversal and so covers every record on disk.
+    bool m_recordsDigestsCoverAllRecords { false };
+    HashMap<String, uint64_t> m_pendingIndexWrites;
+    uint64_t m_lastIndexWriteIdentifier { 0 };
     mutable std::optional<NetworkCache::Salt> m_volatileSalt;
     Vector<WebCore::DOMCacheEngine::CompletionCallback> m_pendingInitializationCallbacks;
     bool m_isWritingCachesToDisk { false };
@@ -62,7 +62,10 @@ static const AtomicString& resourceType()
 
 RefPtr<Cache> Cache::open(const String& cachePath, OptionSet<Option> options)
 {
-    auto storage = Storage::open(cachePath, options.contains(Option::TestingMode) ? Storage::Mode::Testing : Storage::Mode::Normal);
+    OptionSet<Storage::Option> storageOptions;
+    if (options.contains(Option::PackedRecords))
+        storageOptions |= Storage::Option::PackedRecords;
+    auto storage = Storage::open(cachePath, options.contains(Option::TestingMode) ? Storage::Mode::Testing : Storage::Mode::Normal, storageOptions);
 
     LOG(NetworkCache, "(NetworkProcess) opened cache storage, success %d", !!storage);
 
@@ -82,6 +85,11 @@ static void dumpFileChanged(Cache* cache)
 Cache::Cache(Ref<Storage>&& storage, OptionSet<Option> options)
     : m_storage(WTFMove(storage))
 {
+    // Entries the storage drops by itself, like when shrinking, must not keep being served from memory.
+    m_storage->setRecordsRemovedHandler([this](const Vector<Key::HashType>& hashes) {
+        m_hotEntries.remove(hashes);
+    });
+
 #if ENABLE(NETWORK_CACHE_SPECULATIVE_REVALIDATION)
     if (options.contains(Option::SpeculativeRevalidation)) {
         m_lowPowerModeNotifier = std::make_unique<WebCore::LowPowerModeNotifier>([this](bool isLowPowerModeEnabled) {
@@ -121,6 +129,7 @@ Cache::Cache(Ref<Storage>&& storage, OptionSet<Option> options)
 
 Cache::~Cache()
 {
+    m_storage->setRecordsRemovedHandler(nullptr);
 }
 
 void Cache::setCapacity(size_t maximumSize)
@@ -128,6 +137,24 @@ void Cache::setCapacity(size_t maximumSize)
     m_storage->setCapacity(maximumSize);
 }
 
+void Cache::setMemoryCapacity(size_t maximumSize)
+{
+    m_hotEntries.setCapacity(maximumSize);
+}
+
+void Cache::handleMemoryPressure(bool isCritical)
+{
+    if (isCritical)
+        m_hotEntries.clear();
+    else
+        m_hotEntries.prune(m_hotEntries.size() / 2);
+}
+
+void Cache::writeContentsSnapshot(Storage::SnapshotType type, Function<void ()>&& completionHandler)
+{
+    m_storage->writeContentsSnapshot(type, WTFMove(completionHandler));
+}
+
 Key Cache::makeCacheKey(const WebCore::ResourceRequest& request)
 {
     // FIXME: This implements minimal Range header disk cache support. We don't parse
@@ -316,6 +343,24 @@ void Cache::retrieve(const WebCore::ResourceRequest& request, const GlobalFrameI
     }
 #endif
 
+    if (auto entry = m_hotEntries.get(storageKey)) {
+        auto useDecision = applyUseDecision(entry, request);
+
+        LOG(NetworkCache, "(NetworkProcess) retrieved from memory useDecision=%d", static_cast<int>(useDecision));
+
+        if (m_statistics)
+            m_statistics->recordRetrievedCachedEntry(frameID.first, storageKey, request, useDecision);
+
+        // Storage evicts by access time so it needs to know about hits it didn't serve.
+        m_storage->touch(storageKey);
+
+        // Keep the completion asynchronous like it is for storage reads.
+        RunLoop::main().dispatch([completionHandler = WTFMove(completionHandler), entry = WTFMove(entry), info = WTFMove(info)]() mutable {
+            completeRetrieve(WTFMove(completionHandler), WTFMove(entry), info);
+        });
+        return;
+    }
+
     m_storage->retrieve(storageKey, priority, [this, protectedThis = makeRef(*this), request, completionHandler = WTFMove(completionHandler), info = WTFMove(info), storageKey, frameID](auto record, auto timings) mutable {
         info.storageTimings = timings;
 
@@ -332,17 +377,10 @@ void Cache::retrieve(const WebCore::ResourceRequest& request, const GlobalFrameI
         ASSERT(record->key == storageKey);
 
         auto entry = Entry::decodeStorageRecord(*record);
+        if (entry)
+            m_hotEntries.add(*entry);
 
-        auto useDecision = entry ? makeUseDecision(*entry, request) : UseDecision::NoDueToDecodeFailure;
-        switch (useDecision) {
-        case UseDecision::Use:
-            break;
-        case UseDecision::Validate:
-            entry->setNeedsValidation(true);
-            break;
-        default:
-            entry = nullptr;
-        };
+        auto useDecision = applyUseDecision(entry, request);
 
 #if !LOG_DISABLED
         auto elapsed = MonotonicTime::now() - info.startTime;
@@ -356,6 +394,21 @@ void Cache::retrieve(const WebCore::ResourceRequest& request, const GlobalFrameI
     });
 }
 
+UseDecision Cache::applyUseDecision(std::unique_ptr<Entry>& entry, const WebCore::ResourceRequest& request)
+{
+    auto useDecision = entry ? makeUseDecision(*entry, request) : UseDecision::NoDueToDecodeFailure;
+    switch (useDecision) {
+    case UseDecision::Use:
+        break;
+    case UseDecision::Validate:
+        entry->setNeedsValidation(true);
+        break;
+    default:
+        entry = nullptr;
+    };
+    return useDecision;
+}
+
 void Cache::completeRetrieve(RetrieveCompletionHandler&& handler, std::unique_ptr<Entry> entry, RetrieveInfo& info)
 {
     info.completionTime = MonotonicTime::now();
@@ -397,6 +450,7 @@ std::unique_ptr<Entry> Cache::store(const WebCore::ResourceRequest& request, con
 
     auto cacheEntry = makeEntry(request, response, WTFMove(responseData));
     auto record = cacheEntry->encodeAsStorageRecord();
+    m_hotEntries.remove(record.key);
 
     m_storage->store(record, [protectedThis = makeRef(*this), completionHandler = WTFMove(completionHandler)](const Data& bodyData) {
         MappedBody mappedBody;
@@ -430,6 +484,7 @@ std::unique_ptr<Entry> Cache::storeRedirect(const WebCore::ResourceRequest& requ
 
     auto cacheEntry = makeRedirectEntry(request, response, redirectRequest);
     auto record = cacheEntry->encodeAsStorageRecord();
+    m_hotEntries.remove(record.key);
 
     m_storage->store(record, nullptr);
     
@@ -445,6 +500,7 @@ std::unique_ptr<Entry> Cache::update(const WebCore::ResourceRequest& originalReq
 
     auto updateEntry = std::make_unique<Entry>(existingEntry.key(), response, existingEntry.buffer(), WebCore::collectVaryingRequestHeaders(originalRequest, response));
     auto updateRecord = updateEntry->encodeAsStorageRecord();
+    m_hotEntries.remove(updateRecord.key);
 
     m_storage->store(updateRecord, { });
 
@@ -456,6 +512,7 @@ std::unique_ptr<Entry> Cache::update(const WebCore::ResourceRequest& originalReq
 
 void Cache::remove(const Key& key)
 {
+    m_hotEntries.remove(key);
     m_storage->remove(key);
 }
 
@@ -466,6 +523,8 @@ void Cache::remove(const WebCore::ResourceRequest& request)
 
 void Cache::remove(const Vector<Key>& keys, Function<void ()>&& completionHandler)
 {
+    for (auto& key : keys)
+        m_hotEntries.remove(key);
     m_storage->remove(keys, WTFMove(completionHandler));
 }
 
@@ -521,7 +580,8 @@ void Cache::dumpContentsToFile()
     Totals totals;
     auto flags = Storage::TraverseFlag::ComputeWorth | Storage::TraverseFlag::ShareCount;
     size_t capacity = m_storage->capacity();
-    m_storage->traverse(resourceType(), flags, [fd, totals, capacity](const Storage::Record* record, const Storage::RecordInfo& info) mutable {
+    auto filterStatistics = m_storage->contentsFilterStatistics();
+    m_storage->traverse(resourceType(), flags, [fd, totals, capacity, filterStatistics](const Storage::Record* record, const Storage::RecordInfo& info) mutable {
         if (!record) {
             StringBuilder epilogue;
             epilogue.appendLiteral("{}\n],\n");
@@ -537,6 +597,21 @@ void Cache::dumpContentsToFile()
             epilogue.appendLiteral(",\n");
             epilogue.appendLiteral("\"averageWorth\": ");
             epilogue.appendNumber(totals.count ? totals.worth / totals.count : 0);
+            epilogue.appendLiteral(",\n");
+            epilogue.appendLiteral("\"filterLookups\": ");
+            epilogue.appendNumber(filterStatistics.lookupCount);
+            epilogue.appendLiteral(",\n");
+            epilogue.appendLiteral("\"filterNegatives\": ");
+            epilogue.appendNumber(filterStatistics.filteredLookupCount);
+            epilogue.appendLiteral(",\n");
+            epilogue.appendLiteral("\"filterFalsePositives\": ");
+            epilogue.appendNumber(filterStatistics.falsePositiveCount);
+            epilogue.appendLiteral(",\n");
+            epilogue.appendLiteral("\"filterLoad\": ");
+            epilogue.appendNumber(filterStatistics.capacity ? static_cast<double>(filterStatistics.recordCount) / filterStatistics.capacity : 0);
+            epilogue.appendLiteral(",\n");
+            epilogue.appendLiteral("\"filterExpectedFalsePositiveRate\": ");
+            epilogue.appendNumber(filterStatistics.expectedFalsePositiveRate);
             epilogue.appendLiteral("\n");
             epilogue.appendLiteral("}\n}\n");
             auto writeData = epilogue.toString().utf8();
@@ -573,6 +648,8 @@ void Cache::clear(WallTime modifiedSince, Function<void ()>&& completionHandler)
     if (m_statistics)
         m_statistics->clear();
 
+    m_hotEntries.clear();
+
     String anyType;
     m_storage->clear(anyType, modifiedSince, WTFMove(completionHandler));
 
@@ -26,6 +26,7 @@
 #pragma once
 
 #include "NetworkCacheEntry.h"
+#include "NetworkCacheHotEntryCache.h"
 #include "NetworkCacheStorage.h"
 #include "ShareableResource.h"
 #include <WebCore/ResourceResponse.h>
@@ -96,10 +97,14 @@ public:
 #if ENABLE(NETWORK_CACHE_SPECULATIVE_REVALIDATION)
         SpeculativeRevalidation = 1 << 3,
 #endif
+        PackedRecords = 1 << 4,
     };
     static RefPtr<Cache> open(const String& cachePath, OptionSet<Option>);
 
     void setCapacity(size_t);
+    // Capacity of the in-memory cache of recently retrieved entries.
+    void setMemoryCapacity(size_t);
+    void handleMemoryPressure(bool isCritical);
 
     // Completion handler may get called back synchronously on failure.
     struct RetrieveInfo {
@@ -137,11 +142,14 @@ public:
 
     void dumpContentsToFile();
 
+    void writeContentsSnapshot(Storage::SnapshotType, Function<void ()>&&);
+
     String recordsPath() const;
 
 #if ENABLE(NETWORK_CACHE_SPECULATIVE_REVALIDATION)
     SpeculativeLoadManager* speculativeLoadManager() { return m_speculativeLoadManager.get(); }
 #endif
+    Statistics* statistics() { return m_statistics.get(); }
 
     ~Cache();
 
@@ -150,12 +158,14 @@ private:
 
     Key makeCacheKey(const WebCore::ResourceRequest&);
 
+    static UseDecision applyUseDecision(std::unique_ptr<Entry>&, const WebCore::ResourceRequest&);
     static void completeRetrieve(RetrieveCompletionHandler&&, std::unique_ptr<Entry>, RetrieveInfo&);
 
     String dumpFilePath() const;
     void deleteDumpFile();
 
     Ref<Storage> m_storage;
+    HotEntryCache m_hotEntries;
 
 #if ENABLE(NETWORK_CACHE_SPECULATIVE_REVALIDATION)
     std::unique_ptr<WebCore::LowPowerModeNotifier> m_lowPowerModeNotifier;
@@ -90,8 +90,9 @@ BlobStorage::Blob BlobStorage::add(const String& path, const Data& data)
     ASSERT(!RunLoop::isMain());
 
     auto hash = computeSHA1(data, m_salt);
+    auto checksum = computeChecksum(data, m_salt);
     if (data.isEmpty())
-        return { data, hash };
+        return { data, hash, checksum };
 
     auto blobPath = WebCore::FileSystem::fileSystemRepresentation(blobPathForHash(hash));
     auto linkPath = WebCore::FileSystem::fileSystemRepresentation(path);
@@ -103,7 +104,7 @@ BlobStorage::Blob BlobStorage::add(const String& path, const Data& data)
         if (bytesEqual(existingData, data)) {
             if (link(blobPath.data(), linkPath.data()) == -1)
                 WTFLogAlways("Failed to create hard link from %s to %s", blobPath.data(), linkPath.data());
-            return { existingData, hash };
+            return { existingData, hash, checksum };
         }
         unlink(blobPath.data());
     }
@@ -117,40 +118,43 @@ BlobStorage::Blob BlobStorage::add(const String& path, const Data& data)
 
     m_approximateSize += mappedData.size();
 
-    return { mappedData, hash };
+    return { mappedData, hash, checksum };
 #else
-    return { Data(), computeSHA1(data, m_salt) };
+    return { Data(), computeSHA1(data, m_salt), computeChecksum(data, m_salt) };
 #endif
 }
 
-BlobStorage::Blob BlobStorage::get(const String& path)
+Data BlobStorage::get(const String& path)
 {
     ASSERT(!RunLoop::isMain());
 
     auto linkPath = WebCore::FileSystem::fileSystemRepresentation(path);
-    auto data = mapFile(linkPath.data());
-
-    return { data, computeSHA1(data, m_salt) };
+    return mapFile(linkPath.data());
 }
 
-void BlobStorage::remove(const String& path)
+bool BlobStorage::remove(const String& path)
 {
     ASSERT(!RunLoop::isMain());
 
     auto linkPath = WebCore::FileSystem::fileSystemRepresentation(path);
-    unlink(linkPath.data());
+    return !unlink(linkPath.data());
 }
 
 unsigned BlobStorage::shareCount(const String& path)
+{
+    return linkInfo(path).shareCount;
+}
+
+BlobStorage::LinkInfo BlobStorage::linkInfo(const String& path)
 {
     ASSERT(!RunLoop::isMain());
 
     auto linkPath = WebCore::FileSystem::fileSystemRepresentation(path);
     struct stat stat;
     if (::stat(linkPath.data(), &stat) < 0)
-        return 0;
+        return { };
     // Link count is 2 in the single client case (the blob file and a link).
-    return stat.st_nlink - 1;
+    return { static_cast<unsigned>(stat.st_nlink - 1), static_cast<size_t>(stat.st_size) };
 }
 
 }
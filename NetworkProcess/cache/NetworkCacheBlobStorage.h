@@ -42,17 +42,26 @@ public:
     struct Blob {
         Data data;
         SHA1::Digest hash;
+        uint64_t checksum;
     };
     // These are all synchronous and should not be used from the main thread.
     Blob add(const String& path, const Data&);
-    Blob get(const String& path);
+    // The data isn't verified. Callers should compare its checksum to the one stored with the record.
+    Data get(const String& path);
 
     // Blob won't be removed until synchronization.
-    void remove(const String& path);
+    // Returns false if there was nothing to remove.
+    bool remove(const String& path);
 
     unsigned shareCount(const String& path);
+    struct LinkInfo {
+        unsigned shareCount { 0 };
+        size_t size { 0 };
+    };
+    LinkInfo linkInfo(const String& path);
 
     size_t approximateSize() const { return m_approximateSize; }
+    void setApproximateSize(size_t size) { m_approximateSize = size; }
 
     void synchronize();
 
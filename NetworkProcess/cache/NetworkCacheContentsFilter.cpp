@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "NetworkCacheContentsFilter.h"
+
+#include <wtf/MathExtras.h>
+
+namespace WebKit {
+namespace NetworkCache {
+
+// 8192 buckets of 4 fingerprints take 64KB.
+static const size_t minimumBucketCount = 1 << 13;
+static const size_t maximumBucketCount = 1 << 24;
+static const unsigned maximumRelocationCount = 500;
+
+static uint16_t fingerprintForHash(const Key::HashType& hash)
+{
+    // Zero marks an empty slot.
+    uint16_t fingerprint = hash[4] | hash[5] << 8;
+    return fingerprint ? fingerprint : 1;
+}
+
+ContentsFilter::ContentsFilter(size_t expectedEntryCount)
+{
+    // Aim for a load of less than 50% so that there is room to grow before the next synchronization.
+    size_t bucketCount = std::max<size_t>(minimumBucketCount, roundUpToPowerOfTwo(std::min<size_t>(expectedEntryCount * 2 / slotsPerBucket, maximumBucketCount)));
+    m_buckets.resize(bucketCount);
+    clear();
+}
+
+size_t ContentsFilter::bucketIndex(const Key::HashType& hash) const
+{
+    uint32_t index = hash[0] | hash[1] << 8 | hash[2] << 16 | hash[3] << 24;
+    return index & (m_buckets.size() - 1);
+}
+
+size_t ContentsFilter::alternateBucketIndex(size_t index, Fingerprint fingerprint) const
+{
+    // The alternate location is computable from either location and the fingerprint alone, which is what makes relocations possible.
+    uint32_t fingerprintHash = fingerprint * 0x5bd1e995;
+    return (index ^ fingerprintHash) & (m_buckets.size() - 1);
+}
+
+bool ContentsFilter::bucketContains(size_t index, Fingerprint fingerprint) const
+{
+    auto& bucket = m_buckets[index];
+    return std::find(bucket.begin(), bucket.end(), fingerprint) != bucket.end();
+}
+
+bool ContentsFilter::insertIntoBucket(size_t index, Fingerprint fingerprint)
+{
+    auto& bucket = m_buckets[index];
+    auto emptySlot = std::find(bucket.begin(), bucket.end(), 0);
+    if (emptySlot == bucket.end())
+        return false;
+    *emptySlot = fingerprint;
+    return true;
+}
+
+bool ContentsFilter::removeFromBucket(size_t index, Fingerprint fingerprint)
+{
+    auto& bucket = m_buckets[index];
+    auto slot = std::find(bucket.begin(), bucket.end(), fingerprint);
+    if (slot == bucket.end())
+        return false;
+    *slot = 0;
+    return true;
+}
+
+void ContentsFilter::add(const Key::HashType& hash)
+{
+    if (m_hasOverflowed)
+        return;
+
+    auto fingerprint = fingerprintForHash(hash);
+    auto index = bucketIndex(hash);
+    auto alternateIndex = alternateBucketIndex(index, fingerprint);
+
+    // Keys with the same fingerprint and bucket pair each get their own copy so removing one of them doesn't
+    // hide the others. Callers add a hash once per record on disk.
+    ++m_entryCount;
+
+    if (insertIntoBucket(index, fingerprint) || insertIntoBucket(alternateIndex, fingerprint))
+        return;
+
+    index = fingerprint & 1 ? index : alternateIndex;
+    for (unsigned relocation = 0; relocation < maximumRelocationCount; ++relocation) {
+        std::swap(fingerprint, m_buckets[index][relocation % slotsPerBucket]);
+        index = alternateBucketIndex(index, fingerprint);
+        if (insertIntoBucket(index, fingerprint))
+            return;
+    }
+
+    // A fingerprint got evicted so we can no longer answer "no" for anything.
+    m_hasOverflowed = true;
+}
+
+void ContentsFilter::remove(const Key::HashType& hash)
+{
+    if (m_hasOverflowed)
+        return;
+
+    auto fingerprint = fingerprintForHash(hash);
+    auto index = bucketIndex(hash);
+    if (removeFromBucket(index, fingerprint) || removeFromBucket(alternateBucketIndex(index, fingerprint), fingerprint)) {
+        ASSERT(m_entryCount);
+        --m_entryCount;
+    }
+}
+
+bool ContentsFilter::mayContain(const Key::HashType& hash) const
+{
+    if (m_hasOverflowed)
+        return true;
+
+    auto fingerprint = fingerprintForHash(hash);
+    auto index = bucketIndex(hash);
+    return bucketContains(index, fingerprint) || bucketContains(alternateBucketIndex(index, fingerprint), fingerprint);
+}
+
+void ContentsFilter::clear()
+{
+    for (auto& bucket : m_buckets)
+        bucket.fill(0);
+    m_entryCount = 0;
+    m_hasOverflowed = false;
+}
+
+double ContentsFilter::expectedFalsePositiveRate() const
+{
+    if (m_hasOverflowed)
+        return 1;
+    // A lookup compares against the occupied slots of two buckets.
+    double load = static_cast<double>(m_entryCount) / capacity();
+    return std::min(1., 2 * slotsPerBucket * load / (std::numeric_limits<Fingerprint>::max() + 1.));
+}
+
+void ContentsFilter::encode(WTF::Persistence::Encoder& encoder) const
+{
+    encoder << static_cast<uint64_t>(m_buckets.size());
+    encoder << static_cast<uint64_t>(m_entryCount);
+    encoder << m_hasOverflowed;
+    encoder.encodeFixedLengthData(reinterpret_cast<const uint8_t*>(m_buckets.data()), m_buckets.size() * sizeof(Bucket));
+}
+
+bool ContentsFilter::decode(WTF::Persistence::Decoder& decoder, ContentsFilter& filter)
+{
+    uint64_t bucketCount;
+    if (!decoder.decode(bucketCount))
+        return false;
+    if (bucketCount < minimumBucketCount || bucketCount > maximumBucketCount || !hasOneBitSet(bucketCount))
+        return false;
+    uint64_t entryCount;
+    if (!decoder.decode(entryCount))
+        return false;
+    bool hasOverflowed;
+    if (!decoder.decode(hasOverflowed))
+        return false;
+
+    Vector<Bucket> buckets(bucketCount);
+    if (!decoder.decodeFixedLengthData(reinterpret_cast<uint8_t*>(buckets.data()), buckets.size() * sizeof(Bucket)))
+        return false;
+
+    filter.m_buckets = WTFMove(buckets);
+    filter.m_entryCount = entryCount;
+    filter.m_hasOverflowed = hasOverflowed;
+    return true;
+}
+
+}
+}
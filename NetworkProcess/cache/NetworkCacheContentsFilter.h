@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "NetworkCacheKey.h"
+#include <array>
+#include <wtf/Vector.h>
+#include <wtf/persistence/PersistentDecoder.h>
+#include <wtf/persistence/PersistentEncoder.h>
+
+namespace WebKit {
+namespace NetworkCache {
+
+// ContentsFilter is a cuckoo filter of record hashes. Unlike a Bloom filter it supports removals and its size
+// is chosen from the expected number of entries, keeping the false positive rate low for large caches.
+class ContentsFilter {
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    explicit ContentsFilter(size_t expectedEntryCount = 0);
+
+    // Every add stores a copy of the fingerprint and every remove drops one copy.
+    void add(const Key::HashType&);
+    // Removing a hash that was never added may cause false negatives.
+    void remove(const Key::HashType&);
+    bool mayContain(const Key::HashType&) const;
+    void clear();
+
+    size_t entryCount() const { return m_entryCount; }
+    size_t capacity() const { return m_buckets.size() * slotsPerBucket; }
+    // Once an entry fails to fit, the filter answers true for everything until it gets rebuilt with a larger size.
+    bool hasOverflowed() const { return m_hasOverflowed; }
+    double expectedFalsePositiveRate() const;
+
+    void encode(WTF::Persistence::Encoder&) const;
+    static bool decode(WTF::Persistence::Decoder&, ContentsFilter&);
+
+private:
+    static const unsigned slotsPerBucket = 4;
+    using Fingerprint = uint16_t;
+    using Bucket = std::array<Fingerprint, slotsPerBucket>;
+
+    size_t bucketIndex(const Key::HashType&) const;
+    size_t alternateBucketIndex(size_t index, Fingerprint) const;
+    bool bucketContains(size_t index, Fingerprint) const;
+    bool insertIntoBucket(size_t index, Fingerprint);
+    bool removeFromBucket(size_t index, Fingerprint);
+
+    Vector<Bucket> m_buckets;
+    size_t m_entryCount { 0 };
+    bool m_hasOverflowed { false };
+};
+
+}
+}
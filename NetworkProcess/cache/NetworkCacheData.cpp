@@ -70,6 +70,18 @@ Data Data::mapToFile(const char* path) const
     // Flush (asynchronously) to file, turning this into clean memory.
     msync(map, m_size, MS_ASYNC);
 
+#if USE(SOUP)
+    // The descriptor stays with the map and is sent to web processes with the mapped body, see
+    // tryCreateSharedMemory(). Replace it with a read-only one so they can't modify the cache file.
+    int readOnlyFD = open(path, O_RDONLY);
+    close(fd);
+    if (readOnlyFD < 0) {
+        munmap(map, m_size);
+        return { };
+    }
+    fd = readOnlyFD;
+#endif
+
     return Data::adoptMap(map, m_size, fd);
 #else
     return Data();
@@ -133,6 +145,117 @@ SHA1::Digest computeSHA1(const Data& data, const Salt& salt)
     return digest;
 }
 
+// This is XXH64. It keeps four independent accumulators so that consecutive rounds don't wait on each other.
+class ChecksumHasher {
+public:
+    explicit ChecksumHasher(uint64_t seed)
+        : m_seed(seed)
+        , m_lanes { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 }
+    {
+    }
+
+    void addBytes(const uint8_t* data, size_t size)
+    {
+        m_totalSize += size;
+
+        if (m_bufferSize) {
+            size_t bytesToCopy = std::min(size, stripeSize - m_bufferSize);
+            memcpy(m_buffer + m_bufferSize, data, bytesToCopy);
+            m_bufferSize += bytesToCopy;
+            data += bytesToCopy;
+            size -= bytesToCopy;
+            if (m_bufferSize < stripeSize)
+                return;
+            addStripe(m_buffer);
+            m_bufferSize = 0;
+        }
+
+        for (; size >= stripeSize; data += stripeSize, size -= stripeSize)
+            addStripe(data);
+
+        memcpy(m_buffer, data, size);
+        m_bufferSize = size;
+    }
+
+    uint64_t computeHash() const
+    {
+        uint64_t hash;
+        if (m_totalSize >= stripeSize) {
+            hash = rotateLeft(m_lanes[0], 1) + rotateLeft(m_lanes[1], 7) + rotateLeft(m_lanes[2], 12) + rotateLeft(m_lanes[3], 18);
+            for (auto lane : m_lanes)
+                hash = (hash ^ round(0, lane)) * prime1 + prime4;
+        } else
+            hash = m_seed + prime5;
+
+        hash += m_totalSize;
+
+        const uint8_t* data = m_buffer;
+        size_t size = m_bufferSize;
+        for (; size >= 8; data += 8, size -= 8)
+            hash = rotateLeft(hash ^ round(0, read<uint64_t>(data)), 27) * prime1 + prime4;
+        if (size >= 4) {
+            hash = rotateLeft(hash ^ (read<uint32_t>(data) * prime1), 23) * prime2 + prime3;
+            data += 4;
+            size -= 4;
+        }
+        for (; size; ++data, --size)
+            hash = rotateLeft(hash ^ (*data * prime5), 11) * prime1;
+
+        hash ^= hash >> 33;
+        hash *= prime2;
+        hash ^= hash >> 29;
+        hash *= prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static const uint64_t prime1 = 11400714785074694791ULL;
+    static const uint64_t prime2 = 14029467366897019727ULL;
+    static const uint64_t prime3 = 1609587929392839161ULL;
+    static const uint64_t prime4 = 9650029242287828579ULL;
+    static const uint64_t prime5 = 2870177450012600261ULL;
+    static const size_t stripeSize = 32;
+
+    static uint64_t rotateLeft(uint64_t value, unsigned bits) { return (value << bits) | (value >> (64 - bits)); }
+    static uint64_t round(uint64_t accumulator, uint64_t input) { return rotateLeft(accumulator + input * prime2, 31) * prime1; }
+
+    template<typename T> static T read(const uint8_t* data)
+    {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    void addStripe(const uint8_t* data)
+    {
+        m_lanes[0] = round(m_lanes[0], read<uint64_t>(data));
+        m_lanes[1] = round(m_lanes[1], read<uint64_t>(data + 8));
+        m_lanes[2] = round(m_lanes[2], read<uint64_t>(data + 16));
+        m_lanes[3] = round(m_lanes[3], read<uint64_t>(data + 24));
+    }
+
+    const uint64_t m_seed;
+    uint64_t m_lanes[4];
+    uint8_t m_buffer[stripeSize];
+    size_t m_bufferSize { 0 };
+    uint64_t m_totalSize { 0 };
+};
+
+uint64_t computeChecksum(const Data& data, const Salt& salt)
+{
+    uint64_t seed;
+    static_assert(sizeof(seed) == std::tuple_size<Salt>::value, "Salt size");
+    memcpy(&seed, salt.data(), sizeof(seed));
+
+    ChecksumHasher hasher(seed);
+    data.apply([&hasher](const uint8_t* data, size_t size) {
+        hasher.addBytes(data, size);
+        return true;
+    });
+    return hasher.computeHash();
+}
+
 bool bytesEqual(const Data& a, const Data& b)
 {
     if (a.isNull() || b.isNull())
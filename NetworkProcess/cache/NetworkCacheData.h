@@ -104,6 +104,14 @@ using Salt = std::array<uint8_t, 8>;
 
 std::optional<Salt> readOrMakeSalt(const String& path);
 SHA1::Digest computeSHA1(const Data&, const Salt&);
+// Much faster than SHA1 but only good for detecting corruption. Use SHA1 when the hash identifies the data.
+uint64_t computeChecksum(const Data&, const Salt&);
+
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+// Returns null if the data doesn't shrink enough to be worth decompressing on every read.
+Data compressData(const Data&);
+Data decompressData(const Data&, size_t decompressedSize);
+#endif
 
 }
 
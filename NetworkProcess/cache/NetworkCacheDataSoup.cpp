@@ -33,6 +33,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+#include <zlib.h>
+#endif
+
 namespace WebKit {
 namespace NetworkCache {
 
@@ -134,5 +138,76 @@ RefPtr<SharedMemory> Data::tryCreateSharedMemory() const
     return SharedMemory::wrapMap(const_cast<char*>(m_buffer->data), m_buffer->length, m_fileDescriptor);
 }
 
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+// Raw deflate without the zlib wrapper. The record checksums already cover the stored bytes.
+static const int compressionWindowBits = -MAX_WBITS;
+
+Data compressData(const Data& data)
+{
+    if (data.isNull() || data.isEmpty())
+        return { };
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, compressionWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return { };
+
+    // Not worth paying for decompression on every hit unless we save at least 1/8.
+    size_t maximumCompressedSize = data.size() - data.size() / 8;
+    size_t bufferSize = std::min<size_t>(deflateBound(&stream, data.size()), maximumCompressedSize);
+    uint8_t* compressedData = static_cast<uint8_t*>(fastMalloc(bufferSize));
+
+    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.soupBuffer()->data));
+    stream.avail_in = data.size();
+    stream.next_out = compressedData;
+    stream.avail_out = bufferSize;
+
+    // Running out of output space means the result would be too big to keep.
+    int result = deflate(&stream, Z_FINISH);
+    size_t compressedSize = stream.total_out;
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        fastFree(compressedData);
+        return { };
+    }
+
+    compressedData = static_cast<uint8_t*>(fastRealloc(compressedData, compressedSize));
+    GRefPtr<SoupBuffer> buffer = adoptGRef(soup_buffer_new_with_owner(compressedData, compressedSize, compressedData, fastFree));
+    return { WTFMove(buffer) };
+}
+
+Data decompressData(const Data& data, size_t decompressedSize)
+{
+    if (data.isNull() || !decompressedSize)
+        return { };
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, compressionWindowBits) != Z_OK)
+        return { };
+
+    uint8_t* decompressedData = static_cast<uint8_t*>(fastMalloc(decompressedSize));
+
+    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.soupBuffer()->data));
+    stream.avail_in = data.size();
+    stream.next_out = decompressedData;
+    stream.avail_out = decompressedSize;
+
+    // Inflate straight into the final buffer; the expected size comes from the record meta data.
+    int result = inflate(&stream, Z_FINISH);
+    bool success = result == Z_STREAM_END && stream.total_out == decompressedSize;
+    inflateEnd(&stream);
+
+    if (!success) {
+        fastFree(decompressedData);
+        return { };
+    }
+
+    GRefPtr<SoupBuffer> buffer = adoptGRef(soup_buffer_new_with_owner(decompressedData, decompressedSize, decompressedData, fastFree));
+    return { WTFMove(buffer) };
+}
+#endif
+
 } // namespace NetworkCache
 } // namespace WebKit
@@ -29,6 +29,7 @@
 #include "Logging.h"
 #include "NetworkCacheCoders.h"
 #include "NetworkProcess.h"
+#include <WebCore/MIMETypeRegistry.h>
 #include <WebCore/ResourceRequest.h>
 #include <WebCore/SharedBuffer.h>
 #include <wtf/text/StringBuilder.h>
@@ -79,6 +80,26 @@ Entry::Entry(const Storage::Record& storageEntry)
     ASSERT(m_key.type() == "Resource");
 }
 
+static bool isJSONMIMEType(const String& mimeType)
+{
+    return equalLettersIgnoringASCIICase(mimeType, "application/json") || equalLettersIgnoringASCIICase(mimeType, "text/json") || mimeType.endsWithIgnoringASCIICase("+json");
+}
+
+static bool shouldCompressBody(const WebCore::ResourceResponse& response)
+{
+    // Scripts, style sheets, markup, JSON and SVG typically shrink several times. Other images and media are already compressed.
+    auto& mimeType = response.mimeType();
+    if (WebCore::MIMETypeRegistry::isSupportedJavaScriptMIMEType(mimeType))
+        return true;
+    if (equalLettersIgnoringASCIICase(mimeType, "text/css"))
+        return true;
+    if (isJSONMIMEType(mimeType))
+        return true;
+    if (equalLettersIgnoringASCIICase(mimeType, "image/svg+xml"))
+        return true;
+    return WebCore::MIMETypeRegistry::isSupportedNonImageMIMEType(mimeType);
+}
+
 Storage::Record Entry::encodeAsStorageRecord() const
 {
     WTF::Persistence::Encoder encoder;
@@ -101,7 +122,7 @@ Storage::Record Entry::encodeAsStorageRecord() const
     if (m_buffer)
         body = { reinterpret_cast<const uint8_t*>(m_buffer->data()), m_buffer->size() };
 
-    return { m_key, m_timeStamp, header, body, { } };
+    return { m_key, m_timeStamp, header, body, { }, shouldCompressBody(m_response) };
 }
 
 std::unique_ptr<Entry> Entry::decodeStorageRecord(const Storage::Record& storageEntry)
@@ -111,23 +111,33 @@ void deleteDirectoryRecursively(const String& path)
 
 FileTimes fileTimes(const String& path)
 {
+    long long fileSize;
+    return fileTimesAndSize(path, fileSize);
+}
+
+FileTimes fileTimesAndSize(const String& path, long long& fileSize)
+{
+    fileSize = 0;
 #if HAVE(STAT_BIRTHTIME)
     struct stat fileInfo;
     if (stat(WebCore::FileSystem::fileSystemRepresentation(path).data(), &fileInfo))
         return { };
+    fileSize = fileInfo.st_size;
     return { WallTime::fromRawSeconds(fileInfo.st_birthtime), WallTime::fromRawSeconds(fileInfo.st_mtime) };
 #elif USE(SOUP)
     // There's no st_birthtime in some operating systems like Linux, so we use xattrs to set/get the creation time.
     GRefPtr<GFile> file = adoptGRef(g_file_new_for_path(WebCore::FileSystem::fileSystemRepresentation(path).data()));
-    GRefPtr<GFileInfo> fileInfo = adoptGRef(g_file_query_info(file.get(), "xattr::birthtime,time::modified", G_FILE_QUERY_INFO_NONE, nullptr, nullptr));
+    GRefPtr<GFileInfo> fileInfo = adoptGRef(g_file_query_info(file.get(), "xattr::birthtime,time::modified,standard::size", G_FILE_QUERY_INFO_NONE, nullptr, nullptr));
     if (!fileInfo)
         return { };
+    fileSize = g_file_info_get_size(fileInfo.get());
     const char* birthtimeString = g_file_info_get_attribute_string(fileInfo.get(), "xattr::birthtime");
     if (!birthtimeString)
         return { };
     return { WallTime::fromRawSeconds(g_ascii_strtoull(birthtimeString, nullptr, 10)),
         WallTime::fromRawSeconds(g_file_info_get_attribute_uint64(fileInfo.get(), "time::modified")) };
 #elif OS(WINDOWS)
+    WebCore::FileSystem::getFileSize(path, fileSize);
     return FileTimes();
 #endif
 }
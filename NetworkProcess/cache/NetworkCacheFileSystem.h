@@ -40,6 +40,8 @@ struct FileTimes {
     WallTime modification;
 };
 FileTimes fileTimes(const String& path);
+// Same as fileTimes() but also gets the size from the same query.
+FileTimes fileTimesAndSize(const String& path, long long& fileSize);
 void updateFileModificationTimeIfNeeded(const String& path);
 
 bool isSafeToUseMemoryMapForPath(const String& path);
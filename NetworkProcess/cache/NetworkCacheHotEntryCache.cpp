@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "NetworkCacheHotEntryCache.h"
+
+#include <wtf/RunLoop.h>
+
+namespace WebKit {
+namespace NetworkCache {
+
+// A single entry can't take more than this fraction of the capacity.
+static const size_t maximumEntryCostDivisor = 8;
+static const size_t admissionHistorySize = 4096;
+
+void HotEntryCache::setCapacity(size_t capacity)
+{
+    m_capacity = capacity;
+    prune(capacity);
+}
+
+size_t HotEntryCache::cost(const Entry& entry)
+{
+    auto& record = entry.sourceStorageRecord();
+    return sizeof(Entry) + record.header.size() + record.body.size();
+}
+
+std::unique_ptr<Entry> HotEntryCache::get(const Key& key)
+{
+    ASSERT(RunLoop::isMain());
+
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return nullptr;
+
+    m_recencyList.appendOrMoveToLast(key);
+    return std::make_unique<Entry>(*it->value);
+}
+
+bool HotEntryCache::wasRecentlyOffered(const Key& key)
+{
+    uint64_t historyHash;
+    memcpy(&historyHash, key.hash().data(), sizeof(historyHash));
+    // Keep clear of the empty and deleted values.
+    historyHash = (historyHash | 1) & ~(1ULL << 63);
+
+    if (m_admissionHistory.contains(historyHash))
+        return true;
+
+    m_admissionHistory.add(historyHash);
+    m_admissionHistoryOrder.append(historyHash);
+    if (m_admissionHistoryOrder.size() > admissionHistorySize)
+        m_admissionHistory.remove(m_admissionHistoryOrder.takeFirst());
+    return false;
+}
+
+void HotEntryCache::add(const Entry& entry)
+{
+    ASSERT(RunLoop::isMain());
+
+    auto entryCost = cost(entry);
+    if (!entryCost || entryCost > m_capacity / maximumEntryCostDivisor)
+        return;
+
+    auto& key = entry.key();
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        m_size -= cost(*it->value);
+        it->value = std::make_unique<Entry>(entry);
+    } else {
+        if (!wasRecentlyOffered(key))
+            return;
+        m_entries.add(key, std::make_unique<Entry>(entry));
+    }
+    m_size += entryCost;
+    m_recencyList.appendOrMoveToLast(key);
+
+    prune(m_capacity);
+}
+
+void HotEntryCache::remove(const Key& key)
+{
+    ASSERT(RunLoop::isMain());
+
+    auto entry = m_entries.take(key);
+    if (!entry)
+        return;
+    m_size -= cost(*entry);
+    m_recencyList.remove(key);
+}
+
+void HotEntryCache::remove(const Vector<Key::HashType>& hashes)
+{
+    ASSERT(RunLoop::isMain());
+
+    if (m_entries.isEmpty())
+        return;
+
+    auto sortedHashes = hashes;
+    std::sort(sortedHashes.begin(), sortedHashes.end());
+
+    Vector<Key> keysToRemove;
+    for (auto& key : m_recencyList) {
+        if (std::binary_search(sortedHashes.begin(), sortedHashes.end(), key.hash()))
+            keysToRemove.append(key);
+    }
+    for (auto& key : keysToRemove)
+        remove(key);
+}
+
+void HotEntryCache::clear()
+{
+    ASSERT(RunLoop::isMain());
+
+    m_entries.clear();
+    m_recencyList.clear();
+    m_admissionHistory.clear();
+    m_admissionHistoryOrder.clear();
+    m_size = 0;
+}
+
+void HotEntryCache::prune(size_t targetSize)
+{
+    while (m_size > targetSize && !m_recencyList.isEmpty()) {
+        auto key = m_recencyList.first();
+        m_recencyList.removeFirst();
+        auto entry = m_entries.take(key);
+        ASSERT(entry);
+        m_size -= cost(*entry);
+    }
+}
+
+}
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "NetworkCacheEntry.h"
+#include "NetworkCacheKey.h"
+#include <wtf/Deque.h>
+#include <wtf/HashMap.h>
+#include <wtf/HashSet.h>
+#include <wtf/ListHashSet.h>
+
+namespace WebKit {
+namespace NetworkCache {
+
+// HotEntryCache keeps recently retrieved entries in memory so that loading the same resource again, from any
+// web process, doesn't need to read and decode the record again. An entry is only admitted the second time it
+// is offered within a while, so a single pass over many resources doesn't push out the ones that keep being used.
+class HotEntryCache {
+    WTF_MAKE_NONCOPYABLE(HotEntryCache);
+public:
+    HotEntryCache() = default;
+
+    void setCapacity(size_t);
+    size_t capacity() const { return m_capacity; }
+    size_t size() const { return m_size; }
+
+    // Returns a copy of the cached entry.
+    std::unique_ptr<Entry> get(const Key&);
+    void add(const Entry&);
+    void remove(const Key&);
+    void remove(const Vector<Key::HashType>&);
+    void clear();
+
+    // Removes the least recently used entries until the size is at most targetSize.
+    void prune(size_t targetSize);
+
+private:
+    static size_t cost(const Entry&);
+    bool wasRecentlyOffered(const Key&);
+
+    HashMap<Key, std::unique_ptr<Entry>> m_entries;
+    // Least recently used first.
+    ListHashSet<Key> m_recencyList;
+
+    HashSet<uint64_t> m_admissionHistory;
+    Deque<uint64_t> m_admissionHistoryOrder;
+
+    size_t m_capacity { 0 };
+    size_t m_size { 0 };
+};
+
+}
+}
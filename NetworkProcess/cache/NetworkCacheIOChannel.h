@@ -28,6 +28,7 @@
 
 #include "NetworkCacheData.h"
 #include <wtf/Function.h>
+#include <wtf/Lock.h>
 #include <wtf/ThreadSafeRefCounted.h>
 #include <wtf/WorkQueue.h>
 #include <wtf/text/WTFString.h>
@@ -49,6 +50,11 @@ public:
     void read(size_t offset, size_t, WorkQueue*, Function<void (Data&, int error)>&&);
     void write(size_t offset, const Data&, WorkQueue*, Function<void (int error)>&&);
 
+    // Reads that can't be done asynchronously on the calling thread are scheduled with this priority, in the range of Storage::retrieve().
+    void setReadPriority(unsigned priority) { m_readPriority = priority; }
+    // A read that has not started yet completes immediately with ECANCELED.
+    void cancelPendingRead();
+
     const String& path() const { return m_path; }
     Type type() const { return m_type; }
 
@@ -67,6 +73,7 @@ private:
     Type m_type;
 
     int m_fileDescriptor { 0 };
+    unsigned m_readPriority { 0 };
     std::atomic<bool> m_wasDeleted { false }; // Try to narrow down a crash, https://bugs.webkit.org/show_bug.cgi?id=165659
 #if PLATFORM(COCOA)
     OSObjectPtr<dispatch_io_t> m_dispatchIO;
@@ -75,6 +82,9 @@ private:
     GRefPtr<GInputStream> m_inputStream;
     GRefPtr<GOutputStream> m_outputStream;
     GRefPtr<GFileIOStream> m_ioStream;
+    // Protects the handoff between the dispatching thread, the pool thread running the task and cancelPendingRead().
+    Lock m_pendingReadTaskLock;
+    uint64_t m_pendingReadTask { 0 };
 #endif
 };
 
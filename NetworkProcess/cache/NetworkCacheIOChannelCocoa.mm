@@ -102,6 +102,11 @@ void IOChannel::read(size_t offset, size_t size, WorkQueue* queue, Function<void
     }).get());
 }
 
+void IOChannel::cancelPendingRead()
+{
+    // Reads are scheduled by libdispatch, there is nothing pending on our side.
+}
+
 void IOChannel::write(size_t offset, const Data& data, WorkQueue* queue, Function<void (int error)>&& completionHandler)
 {
     RefPtr<IOChannel> channel(this);
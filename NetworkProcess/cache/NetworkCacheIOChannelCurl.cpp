@@ -52,6 +52,11 @@ void IOChannel::read(size_t offset, size_t size, WorkQueue* queue, Function<void
     notImplemented();
 }
 
+void IOChannel::cancelPendingRead()
+{
+    notImplemented();
+}
+
 void IOChannel::write(size_t offset, const Data& data, WorkQueue* queue, Function<void(int error)>&& completionHandler)
 {
     notImplemented();
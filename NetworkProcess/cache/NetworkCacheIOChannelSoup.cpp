@@ -27,6 +27,8 @@
 #include "NetworkCacheIOChannel.h"
 
 #include "NetworkCacheFileSystem.h"
+#include "NetworkCacheIOThreadPool.h"
+#include <errno.h>
 #include <wtf/MainThread.h>
 #include <wtf/RunLoop.h>
 #include <wtf/glib/GUniquePtr.h>
@@ -35,8 +37,6 @@
 namespace WebKit {
 namespace NetworkCache {
 
-static const size_t gDefaultReadBufferSize = 4096;
-
 IOChannel::IOChannel(const String& filePath, Type type)
     : m_path(filePath)
     , m_type(type)
@@ -84,32 +84,49 @@ static inline void runTaskInQueue(Function<void ()>&& task, WorkQueue* queue)
     RunLoop::main().dispatch(WTFMove(task));
 }
 
-static void fillDataFromReadBuffer(SoupBuffer* readBuffer, size_t size, Data& data)
+// Seeks to the requested offset and returns how many bytes can actually be read from there, so that
+// the whole range can be read into a single buffer allocated upfront.
+static std::optional<size_t> seekAndComputeReadSize(GInputStream* stream, size_t offset, size_t size)
 {
-    GRefPtr<SoupBuffer> buffer;
-    if (size != readBuffer->length) {
+    GRefPtr<GFileInfo> info = adoptGRef(g_file_input_stream_query_info(G_FILE_INPUT_STREAM(stream), G_FILE_ATTRIBUTE_STANDARD_SIZE, nullptr, nullptr));
+    if (!info)
+        return std::nullopt;
+
+    auto fileSize = static_cast<size_t>(g_file_info_get_size(info.get()));
+    if (offset >= fileSize)
+        return 0;
+
+    if (!g_seekable_seek(G_SEEKABLE(stream), offset, G_SEEK_SET, nullptr, nullptr))
+        return std::nullopt;
+
+    return std::min(size, fileSize - offset);
+}
+
+static GRefPtr<SoupBuffer> createReadBuffer(size_t size)
+{
+    ASSERT(size);
+    uint8_t* bufferData = static_cast<uint8_t*>(fastMalloc(size));
+    return adoptGRef(soup_buffer_new_with_owner(bufferData, size, bufferData, fastFree));
+}
+
+static Data dataFromReadBuffer(GRefPtr<SoupBuffer>&& readBuffer, size_t bytesRead)
+{
+    if (!bytesRead)
+        return { };
+
+    if (bytesRead != readBuffer->length) {
         // The subbuffer does not copy the data.
-        buffer = adoptGRef(soup_buffer_new_subbuffer(readBuffer, 0, size));
-    } else
-        buffer = readBuffer;
-
-    if (data.isNull()) {
-        // First chunk, we need to force the data to be copied.
-        data = { reinterpret_cast<const uint8_t*>(buffer->data), size };
-    } else {
-        Data dataRead(WTFMove(buffer));
-        // Concatenate will copy the data.
-        data = concatenate(data, dataRead);
+        readBuffer = adoptGRef(soup_buffer_new_subbuffer(readBuffer.get(), 0, bytesRead));
     }
+    return { WTFMove(readBuffer) };
 }
 
 struct ReadAsyncData {
     RefPtr<IOChannel> channel;
     GRefPtr<SoupBuffer> buffer;
     RefPtr<WorkQueue> queue;
-    size_t bytesToRead;
+    size_t bytesRead;
     Function<void (Data&, int error)> completionHandler;
-    Data data;
 };
 
 static void inputStreamReadReadyCallback(GInputStream* stream, GAsyncResult* result, gpointer userData)
@@ -119,35 +136,29 @@ static void inputStreamReadReadyCallback(GInputStream* stream, GAsyncResult* res
     if (bytesRead == -1) {
         WorkQueue* queue = asyncData->queue.get();
         runTaskInQueue([asyncData = WTFMove(asyncData)] {
-            asyncData->completionHandler(asyncData->data, -1);
-        }, queue);
-        return;
-    }
-
-    if (!bytesRead) {
-        WorkQueue* queue = asyncData->queue.get();
-        runTaskInQueue([asyncData = WTFMove(asyncData)] {
-            asyncData->completionHandler(asyncData->data, 0);
+            Data data;
+            asyncData->completionHandler(data, -1);
         }, queue);
         return;
     }
 
-    ASSERT(bytesRead > 0);
-    fillDataFromReadBuffer(asyncData->buffer.get(), static_cast<size_t>(bytesRead), asyncData->data);
+    ASSERT(bytesRead >= 0);
+    asyncData->bytesRead += static_cast<size_t>(bytesRead);
 
-    size_t pendingBytesToRead = asyncData->bytesToRead - asyncData->data.size();
-    if (!pendingBytesToRead) {
+    size_t pendingBytesToRead = asyncData->buffer->length - asyncData->bytesRead;
+    if (!bytesRead || !pendingBytesToRead) {
         WorkQueue* queue = asyncData->queue.get();
         runTaskInQueue([asyncData = WTFMove(asyncData)] {
-            asyncData->completionHandler(asyncData->data, 0);
+            Data data = dataFromReadBuffer(WTFMove(asyncData->buffer), asyncData->bytesRead);
+            asyncData->completionHandler(data, 0);
         }, queue);
         return;
     }
 
-    size_t bytesToRead = std::min(pendingBytesToRead, asyncData->buffer->length);
+    // Keep filling the same buffer, so that no intermediate chunks need to be copied.
     // Use a local variable for the data buffer to pass it to g_input_stream_read_async(), because ReadAsyncData is released.
-    auto data = const_cast<char*>(asyncData->buffer->data);
-    g_input_stream_read_async(stream, data, bytesToRead, RunLoopSourcePriority::DiskCacheRead, nullptr,
+    auto data = const_cast<char*>(asyncData->buffer->data) + asyncData->bytesRead;
+    g_input_stream_read_async(stream, data, pendingBytesToRead, RunLoopSourcePriority::DiskCacheRead, nullptr,
         reinterpret_cast<GAsyncReadyCallback>(inputStreamReadReadyCallback), asyncData.release());
 }
 
@@ -167,13 +178,18 @@ void IOChannel::read(size_t offset, size_t size, WorkQueue* queue, Function<void
         return;
     }
 
-    size_t bufferSize = std::min(size, gDefaultReadBufferSize);
-    uint8_t* bufferData = static_cast<uint8_t*>(fastMalloc(bufferSize));
-    GRefPtr<SoupBuffer> buffer = adoptGRef(soup_buffer_new_with_owner(bufferData, bufferSize, bufferData, fastFree));
-    ReadAsyncData* asyncData = new ReadAsyncData { this, buffer.get(), queue, size, WTFMove(completionHandler), { } };
+    auto bytesToRead = seekAndComputeReadSize(m_inputStream.get(), offset, size);
+    if (!bytesToRead || !*bytesToRead) {
+        runTaskInQueue([channel, completionHandler = WTFMove(completionHandler), error = bytesToRead ? 0 : -1] {
+            Data data;
+            completionHandler(data, error);
+        }, queue);
+        return;
+    }
 
-    // FIXME: implement offset.
-    g_input_stream_read_async(m_inputStream.get(), const_cast<char*>(buffer->data), bufferSize, RunLoopSourcePriority::DiskCacheRead, nullptr,
+    GRefPtr<SoupBuffer> buffer = createReadBuffer(*bytesToRead);
+    ReadAsyncData* asyncData = new ReadAsyncData { this, buffer.get(), queue, 0, WTFMove(completionHandler) };
+    g_input_stream_read_async(m_inputStream.get(), const_cast<char*>(buffer->data), buffer->length, RunLoopSourcePriority::DiskCacheRead, nullptr,
         reinterpret_cast<GAsyncReadyCallback>(inputStreamReadReadyCallback), asyncData);
 }
 
@@ -182,41 +198,60 @@ void IOChannel::readSyncInThread(size_t offset, size_t size, WorkQueue* queue, F
     ASSERT(!RunLoop::isMain());
 
     RefPtr<IOChannel> channel(this);
-    Thread::create("IOChannel::readSync", [channel, size, queue, completionHandler = WTFMove(completionHandler)] () mutable {
-        size_t bufferSize = std::min(size, gDefaultReadBufferSize);
-        uint8_t* bufferData = static_cast<uint8_t*>(fastMalloc(bufferSize));
-        GRefPtr<SoupBuffer> readBuffer = adoptGRef(soup_buffer_new_with_owner(bufferData, bufferSize, bufferData, fastFree));
-        Data data;
-        size_t pendingBytesToRead = size;
-        size_t bytesToRead = bufferSize;
-        do {
-            // FIXME: implement offset.
-            gssize bytesRead = g_input_stream_read(channel->m_inputStream.get(), const_cast<char*>(readBuffer->data), bytesToRead, nullptr, nullptr);
-            if (bytesRead == -1) {
+    // The lock is held until the identifier is stored, so the task can't clear it before it is set.
+    std::lock_guard<Lock> lock(m_pendingReadTaskLock);
+    m_pendingReadTask = IOThreadPool::singleton().dispatch(m_readPriority, [channel, offset, size, queue, completionHandler = WTFMove(completionHandler)] (bool isCanceled) mutable {
+        {
+            std::lock_guard<Lock> lock(channel->m_pendingReadTaskLock);
+            channel->m_pendingReadTask = 0;
+        }
+        if (isCanceled) {
+            runTaskInQueue([channel, completionHandler = WTFMove(completionHandler)] {
+                Data data;
+                completionHandler(data, ECANCELED);
+            }, queue);
+            return;
+        }
+
+        auto bytesToRead = seekAndComputeReadSize(channel->m_inputStream.get(), offset, size);
+        if (!bytesToRead) {
+            runTaskInQueue([channel, completionHandler = WTFMove(completionHandler)] {
+                Data data;
+                completionHandler(data, -1);
+            }, queue);
+            return;
+        }
+
+        GRefPtr<SoupBuffer> readBuffer;
+        gsize bytesRead = 0;
+        if (*bytesToRead) {
+            readBuffer = createReadBuffer(*bytesToRead);
+            if (!g_input_stream_read_all(channel->m_inputStream.get(), const_cast<char*>(readBuffer->data), readBuffer->length, &bytesRead, nullptr, nullptr)) {
                 runTaskInQueue([channel, completionHandler = WTFMove(completionHandler)] {
                     Data data;
                     completionHandler(data, -1);
                 }, queue);
                 return;
             }
+        }
 
-            if (!bytesRead)
-                break;
-
-            ASSERT(bytesRead > 0);
-            fillDataFromReadBuffer(readBuffer.get(), static_cast<size_t>(bytesRead), data);
-
-            pendingBytesToRead = size - data.size();
-            bytesToRead = std::min(pendingBytesToRead, readBuffer->length);
-        } while (pendingBytesToRead);
-
-        GRefPtr<SoupBuffer> bufferCapture = data.soupBuffer();
-        runTaskInQueue([channel, bufferCapture, completionHandler = WTFMove(completionHandler)] {
-            GRefPtr<SoupBuffer> buffer = bufferCapture;
-            Data data = { WTFMove(buffer) };
+        runTaskInQueue([channel, readBuffer = WTFMove(readBuffer), bytesRead, completionHandler = WTFMove(completionHandler)] () mutable {
+            Data data = dataFromReadBuffer(WTFMove(readBuffer), bytesRead);
             completionHandler(data, 0);
         }, queue);
-    })->detach();
+    });
+}
+
+void IOChannel::cancelPendingRead()
+{
+    uint64_t pendingReadTask;
+    {
+        std::lock_guard<Lock> lock(m_pendingReadTaskLock);
+        pendingReadTask = std::exchange(m_pendingReadTask, 0);
+    }
+    // Canceling outside of the lock, the canceled task takes it to clear the identifier.
+    if (pendingReadTask)
+        IOThreadPool::singleton().cancel(pendingReadTask);
 }
 
 struct WriteAsyncData {
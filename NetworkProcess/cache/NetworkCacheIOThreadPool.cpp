@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "NetworkCacheIOThreadPool.h"
+
+#include <wtf/Threading.h>
+
+namespace WebKit {
+namespace NetworkCache {
+
+IOThreadPool& IOThreadPool::singleton()
+{
+    static NeverDestroyed<IOThreadPool> pool;
+    return pool;
+}
+
+IOThreadPool::TaskIdentifier IOThreadPool::dispatch(unsigned priority, Task&& task)
+{
+    priority = std::min(priority, maximumPriority);
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    auto identifier = ++m_lastTaskIdentifier;
+    m_pendingTasksByPriority[priority].append({ identifier, priority, WTFMove(task) });
+
+    if (m_idleThreadCount || m_threadCount >= maximumThreadCount) {
+        m_condition.notifyOne();
+        return identifier;
+    }
+
+    // Threads are only spawned on demand and then stay around, so there is no thread creation on the hot path.
+    ++m_threadCount;
+    Thread::create("NetworkCache::IOThreadPool", [this] {
+        runThread();
+    })->detach();
+
+    return identifier;
+}
+
+void IOThreadPool::cancel(TaskIdentifier identifier)
+{
+    std::lock_guard<Lock> lock(m_lock);
+
+    for (auto& pendingTasks : m_pendingTasksByPriority) {
+        auto found = pendingTasks.findIf([identifier](auto& pendingTask) {
+            return pendingTask.identifier == identifier;
+        });
+        if (found == pendingTasks.end())
+            continue;
+
+        m_canceledTasks.append(WTFMove(*found));
+        pendingTasks.remove(found);
+
+        m_condition.notifyOne();
+        return;
+    }
+}
+
+bool IOThreadPool::takeNextTask(PendingTask& pendingTask, bool& isCanceled)
+{
+    ASSERT(m_lock.isLocked());
+
+    // Canceled tasks don't do any I/O, let them complete first.
+    if (!m_canceledTasks.isEmpty()) {
+        pendingTask = m_canceledTasks.takeFirst();
+        isCanceled = true;
+        return true;
+    }
+
+    for (int priority = maximumPriority; priority >= 0; --priority) {
+        auto& pendingTasks = m_pendingTasksByPriority[priority];
+        if (pendingTasks.isEmpty())
+            continue;
+
+        pendingTask = pendingTasks.takeFirst();
+        isCanceled = false;
+        return true;
+    }
+    return false;
+}
+
+void IOThreadPool::runThread()
+{
+    while (true) {
+        PendingTask pendingTask;
+        bool isCanceled = false;
+        {
+            std::unique_lock<Lock> lock(m_lock);
+            ++m_idleThreadCount;
+            m_condition.wait(lock, [&] {
+                return takeNextTask(pendingTask, isCanceled);
+            });
+            --m_idleThreadCount;
+        }
+
+        pendingTask.task(isCanceled);
+    }
+}
+
+}
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <wtf/Condition.h>
+#include <wtf/Deque.h>
+#include <wtf/Function.h>
+#include <wtf/Lock.h>
+#include <wtf/NeverDestroyed.h>
+
+namespace WebKit {
+namespace NetworkCache {
+
+// A small, bounded set of threads shared by all the disk cache instances for doing blocking file I/O.
+// Tasks are run in the order of their priority, using the same range as Storage::retrieve().
+class IOThreadPool {
+    WTF_MAKE_NONCOPYABLE(IOThreadPool);
+public:
+    static IOThreadPool& singleton();
+
+    static const unsigned maximumPriority = 4;
+    static const unsigned maximumThreadCount = 4;
+
+    using TaskIdentifier = uint64_t;
+    // The task is always invoked exactly once. It is passed true if it was canceled before it started
+    // running, so that it can complete without doing any I/O.
+    using Task = Function<void (bool isCanceled)>;
+
+    TaskIdentifier dispatch(unsigned priority, Task&&);
+    void cancel(TaskIdentifier);
+
+private:
+    friend class NeverDestroyed<IOThreadPool>;
+    IOThreadPool() = default;
+
+    struct PendingTask {
+        TaskIdentifier identifier { 0 };
+        unsigned priority { 0 };
+        Task task;
+    };
+
+    bool takeNextTask(PendingTask&, bool& isCanceled);
+    void runThread();
+
+    Lock m_lock;
+    Condition m_condition;
+    Deque<PendingTask> m_pendingTasksByPriority[maximumPriority + 1];
+    Deque<PendingTask> m_canceledTasks;
+    TaskIdentifier m_lastTaskIdentifier { 0 };
+    unsigned m_threadCount { 0 };
+    unsigned m_idleThreadCount { 0 };
+};
+
+}
+}
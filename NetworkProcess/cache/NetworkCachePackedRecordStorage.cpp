@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "NetworkCachePackedRecordStorage.h"
+
+#include "Logging.h"
+#include <WebCore/FileSystem.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <wtf/RunLoop.h>
+#include <wtf/text/CString.h>
+
+#if !OS(WINDOWS)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WebKit {
+namespace NetworkCache {
+
+static const uint32_t entryMagic = 0x4e435250; // 'NCRP'
+static const char compactionSuffix[] = ".compact";
+
+struct EntryHeader {
+    uint32_t magic;
+    // Zero for removals.
+    uint32_t recordSize;
+    Key::HashType hash;
+    double creationTime;
+    double accessTime;
+};
+
+static bool readAt(int fd, uint64_t offset, void* buffer, size_t size)
+{
+#if !OS(WINDOWS)
+    auto* bytes = static_cast<uint8_t*>(buffer);
+    while (size) {
+        auto bytesRead = pread(fd, bytes, size, offset);
+        if (bytesRead <= 0) {
+            if (bytesRead == -1 && errno == EINTR)
+                continue;
+            return false;
+        }
+        bytes += bytesRead;
+        offset += bytesRead;
+        size -= bytesRead;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+static bool writeAt(int fd, uint64_t offset, const void* buffer, size_t size)
+{
+#if !OS(WINDOWS)
+    auto* bytes = static_cast<const uint8_t*>(buffer);
+    while (size) {
+        auto bytesWritten = pwrite(fd, bytes, size, offset);
+        if (bytesWritten <= 0) {
+            if (bytesWritten == -1 && errno == EINTR)
+                continue;
+            return false;
+        }
+        bytes += bytesWritten;
+        offset += bytesWritten;
+        size -= bytesWritten;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+static bool truncateFile(int fd, uint64_t size)
+{
+#if !OS(WINDOWS)
+    return ftruncate(fd, size) != -1;
+#else
+    return false;
+#endif
+}
+
+PackedRecordStorage::PackedRecordStorage(const String& packFilePath)
+    : m_packFilePath(packFilePath.isolatedCopy())
+{
+}
+
+PackedRecordStorage::~PackedRecordStorage()
+{
+    closeFile();
+}
+
+void PackedRecordStorage::openFile()
+{
+    ASSERT(m_lock.isLocked());
+
+    if (m_fileDescriptor != -1)
+        return;
+#if !OS(WINDOWS)
+    auto path = WebCore::FileSystem::fileSystemRepresentation(m_packFilePath);
+    m_fileDescriptor = open(path.data(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (m_fileDescriptor == -1)
+        return;
+    struct stat stat;
+    m_fileSize = fstat(m_fileDescriptor, &stat) ? 0 : stat.st_size;
+#endif
+}
+
+void PackedRecordStorage::closeFile()
+{
+#if !OS(WINDOWS)
+    if (m_fileDescriptor != -1)
+        close(m_fileDescriptor);
+#endif
+    m_fileDescriptor = -1;
+    m_fileSize = 0;
+}
+
+bool PackedRecordStorage::appendEntry(const Key::HashType& hash, const Data* record, WallTime creationTime, WallTime accessTime, Location& location)
+{
+    ASSERT(m_lock.isLocked());
+
+    openFile();
+    if (m_fileDescriptor == -1)
+        return false;
+
+    EntryHeader header { };
+    header.magic = entryMagic;
+    header.recordSize = record ? record->size() : 0;
+    header.hash = hash;
+    header.creationTime = creationTime.secondsSinceEpoch().seconds();
+    header.accessTime = accessTime.secondsSinceEpoch().seconds();
+
+    auto entryOffset = m_fileSize;
+    bool success = writeAt(m_fileDescriptor, entryOffset, &header, sizeof(header));
+    auto recordOffset = entryOffset + sizeof(header);
+    if (success && record) {
+        record->apply([&](const uint8_t* data, size_t size) {
+            success = writeAt(m_fileDescriptor, recordOffset, data, size);
+            recordOffset += size;
+            return success;
+        });
+    }
+    if (!success) {
+        // Don't leave a partial entry behind.
+        if (!truncateFile(m_fileDescriptor, m_fileSize))
+            RELEASE_LOG_ERROR(NetworkCacheStorage, "Failed to truncate packed records file: %d", errno);
+        return false;
+    }
+
+    m_fileSize = recordOffset;
+    location = { entryOffset, header.recordSize, creationTime, accessTime };
+    return true;
+}
+
+void PackedRecordStorage::removeFromIndex(const Key::HashType& hash)
+{
+    ASSERT(m_lock.isLocked());
+
+    auto it = m_index.find(hash);
+    if (it == m_index.end())
+        return;
+    m_liveSize -= it->value.recordSize;
+    m_deadSize += sizeof(EntryHeader) + it->value.recordSize;
+    m_index.remove(it);
+}
+
+bool PackedRecordStorage::add(const Key::HashType& hash, const Data& record)
+{
+    ASSERT(!RunLoop::isMain());
+    ASSERT(record.size() <= maximumRecordSize);
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    auto now = WallTime::now();
+    Location location;
+    if (!appendEntry(hash, &record, now, now, location))
+        return false;
+
+    removeFromIndex(hash);
+    m_index.add(hash, location);
+    m_liveSize += location.recordSize;
+    return true;
+}
+
+Data PackedRecordStorage::get(const Key::HashType& hash)
+{
+    ASSERT(!RunLoop::isMain());
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    auto it = m_index.find(hash);
+    if (it == m_index.end() || m_fileDescriptor == -1)
+        return { };
+
+    Vector<uint8_t> buffer(it->value.recordSize);
+    if (!readAt(m_fileDescriptor, it->value.offset + sizeof(EntryHeader), buffer.data(), buffer.size()))
+        return { };
+    return { buffer.data(), buffer.size() };
+}
+
+bool PackedRecordStorage::remove(const Key::HashType& hash)
+{
+    ASSERT(!RunLoop::isMain());
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    if (!m_index.contains(hash))
+        return false;
+
+    Location tombstone;
+    if (!appendEntry(hash, nullptr, { }, { }, tombstone))
+        return false;
+    removeFromIndex(hash);
+    m_deadSize += sizeof(EntryHeader);
+    return true;
+}
+
+void PackedRecordStorage::clear()
+{
+    ASSERT(!RunLoop::isMain());
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    closeFile();
+    WebCore::FileSystem::deleteFile(m_packFilePath);
+    m_index.clear();
+    m_liveSize = 0;
+    m_deadSize = 0;
+}
+
+bool PackedRecordStorage::contains(const Key::HashType& hash) const
+{
+    std::lock_guard<Lock> lock(m_lock);
+    return m_index.contains(hash);
+}
+
+std::optional<FileTimes> PackedRecordStorage::times(const Key::HashType& hash) const
+{
+    std::lock_guard<Lock> lock(m_lock);
+
+    auto it = m_index.find(hash);
+    if (it == m_index.end())
+        return std::nullopt;
+    return FileTimes { it->value.creationTime, it->value.accessTime };
+}
+
+void PackedRecordStorage::updateAccessTime(const Key::HashType& hash)
+{
+    ASSERT(!RunLoop::isMain());
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    auto it = m_index.find(hash);
+    if (it == m_index.end() || m_fileDescriptor == -1)
+        return;
+
+    // Like updateFileModificationTimeIfNeeded(), avoid writes for frequently accessed records.
+    auto now = WallTime::now();
+    if (now - it->value.accessTime < 1_h)
+        return;
+
+    double accessTime = now.secondsSinceEpoch().seconds();
+    if (writeAt(m_fileDescriptor, it->value.offset + offsetof(EntryHeader, accessTime), &accessTime, sizeof(accessTime)))
+        it->value.accessTime = now;
+}
+
+void PackedRecordStorage::traverse(const TraverseFunction& function)
+{
+    ASSERT(!RunLoop::isMain());
+
+    Vector<Key::HashType> hashes;
+    {
+        std::lock_guard<Lock> lock(m_lock);
+        hashes = copyToVector(m_index.keys());
+    }
+
+    // Records are read one by one without holding the lock so that the function can modify the storage.
+    for (auto& hash : hashes) {
+        auto record = get(hash);
+        auto recordTimes = times(hash);
+        if (record.isNull() || !recordTimes)
+            continue;
+        function(hash, record, *recordTimes);
+    }
+}
+
+void PackedRecordStorage::synchronize(const Function<void (const Key::HashType&)>& function)
+{
+    ASSERT(!RunLoop::isMain());
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    closeFile();
+    m_index.clear();
+    m_liveSize = 0;
+    m_deadSize = 0;
+
+    // A compaction that was interrupted leaves the original file untouched.
+    WebCore::FileSystem::deleteFile(m_packFilePath + compactionSuffix);
+
+    openFile();
+    if (m_fileDescriptor == -1)
+        return;
+
+    auto path = WebCore::FileSystem::fileSystemRepresentation(m_packFilePath);
+    auto fileData = mapFile(path.data());
+
+    uint64_t offset = 0;
+    fileData.apply([&](const uint8_t* data, size_t size) {
+        while (offset + sizeof(EntryHeader) <= size) {
+            EntryHeader header;
+            memcpy(&header, data + offset, sizeof(header));
+            if (header.magic != entryMagic || offset + sizeof(header) + header.recordSize > size)
+                break;
+
+            removeFromIndex(header.hash);
+            if (header.recordSize) {
+                auto creationTime = WallTime::fromRawSeconds(header.creationTime);
+                auto accessTime = WallTime::fromRawSeconds(header.accessTime);
+                m_index.add(header.hash, Location { offset, header.recordSize, creationTime, accessTime });
+                m_liveSize += header.recordSize;
+            } else
+                m_deadSize += sizeof(header);
+
+            offset += sizeof(header) + header.recordSize;
+        }
+        return false;
+    });
+
+    if (offset != m_fileSize) {
+        // The tail was partially written, drop it.
+        LOG(NetworkCacheStorage, "(NetworkProcess) truncating packed records file from %" PRIu64 " to %" PRIu64, m_fileSize, offset);
+        if (truncateFile(m_fileDescriptor, offset))
+            m_fileSize = offset;
+    }
+
+    for (auto& hash : m_index.keys())
+        function(hash);
+
+    LOG(NetworkCacheStorage, "(NetworkProcess) packed records synchronization completed recordCount=%u liveSize=%zu deadSize=%zu", m_index.size(), approximateSize(), m_deadSize);
+}
+
+void PackedRecordStorage::compactIfNeeded()
+{
+    ASSERT(!RunLoop::isMain());
+
+    std::lock_guard<Lock> lock(m_lock);
+
+    const size_t minimumDeadSizeForCompaction = 1024 * 1024;
+    if (m_fileDescriptor == -1 || m_deadSize < minimumDeadSizeForCompaction || m_deadSize < m_liveSize)
+        return;
+
+    LOG(NetworkCacheStorage, "(NetworkProcess) compacting packed records liveSize=%zu deadSize=%zu", approximateSize(), m_deadSize);
+
+#if !OS(WINDOWS)
+    auto compactionPath = WebCore::FileSystem::fileSystemRepresentation(m_packFilePath + compactionSuffix);
+    int compactionFileDescriptor = open(compactionPath.data(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (compactionFileDescriptor == -1)
+        return;
+
+    // Keep the relative order of the records.
+    Vector<std::pair<Key::HashType, Location>> entries;
+    entries.reserveInitialCapacity(m_index.size());
+    for (auto& entry : m_index)
+        entries.uncheckedAppend({ entry.key, entry.value });
+    std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) {
+        return a.second.offset < b.second.offset;
+    });
+
+    Index compactedIndex;
+    uint64_t compactedOffset = 0;
+    Vector<uint8_t> buffer;
+    for (auto& entry : entries) {
+        auto entrySize = sizeof(EntryHeader) + entry.second.recordSize;
+        buffer.resize(entrySize);
+        if (!readAt(m_fileDescriptor, entry.second.offset, buffer.data(), entrySize) || !writeAt(compactionFileDescriptor, compactedOffset, buffer.data(), entrySize)) {
+            close(compactionFileDescriptor);
+            unlink(compactionPath.data());
+            return;
+        }
+        auto location = entry.second;
+        location.offset = compactedOffset;
+        compactedIndex.add(entry.first, location);
+        compactedOffset += entrySize;
+    }
+
+    auto path = WebCore::FileSystem::fileSystemRepresentation(m_packFilePath);
+    if (rename(compactionPath.data(), path.data()) == -1) {
+        close(compactionFileDescriptor);
+        unlink(compactionPath.data());
+        return;
+    }
+
+    close(m_fileDescriptor);
+    m_fileDescriptor = compactionFileDescriptor;
+    m_fileSize = compactedOffset;
+    m_index = WTFMove(compactedIndex);
+    m_deadSize = 0;
+#endif
+}
+
+}
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "NetworkCacheData.h"
+#include "NetworkCacheFileSystem.h"
+#include "NetworkCacheKey.h"
+#include <wtf/HashMap.h>
+#include <wtf/Lock.h>
+#include <wtf/Optional.h>
+
+namespace WebKit {
+namespace NetworkCache {
+
+// PackedRecordStorage appends small records to a single file instead of storing each of them in its own file.
+// An in-memory index maps record hashes to their location. Removals are appended as tombstones and the space
+// they leave behind is reclaimed by compaction.
+class PackedRecordStorage {
+    WTF_MAKE_NONCOPYABLE(PackedRecordStorage);
+public:
+    explicit PackedRecordStorage(const String& packFilePath);
+    ~PackedRecordStorage();
+
+    static const size_t maximumRecordSize = 8 * 1024;
+
+    // These are all synchronous and should not be used from the main thread.
+    bool add(const Key::HashType&, const Data& record);
+    Data get(const Key::HashType&);
+    // Returns false if the record was not in the pack.
+    bool remove(const Key::HashType&);
+    void clear();
+
+    bool contains(const Key::HashType&) const;
+    std::optional<FileTimes> times(const Key::HashType&) const;
+    void updateAccessTime(const Key::HashType&);
+
+    using TraverseFunction = Function<void (const Key::HashType&, const Data& record, const FileTimes&)>;
+    void traverse(const TraverseFunction&);
+
+    // Rebuilds the index from the pack file, calling the function for every record found.
+    void synchronize(const Function<void (const Key::HashType&)>&);
+    void compactIfNeeded();
+
+    size_t approximateSize() const { return m_liveSize; }
+
+private:
+    struct Location {
+        uint64_t offset { 0 };
+        uint32_t recordSize { 0 };
+        WallTime creationTime;
+        WallTime accessTime;
+    };
+
+    struct HashTypeHash {
+        static unsigned hash(const Key::HashType& hash)
+        {
+            // The hash bytes have no alignment guarantee.
+            unsigned result;
+            memcpy(&result, hash.data(), sizeof(result));
+            return result;
+        }
+        static bool equal(const Key::HashType& a, const Key::HashType& b) { return a == b; }
+        static const bool safeToCompareToEmptyOrDeleted = true;
+    };
+    struct HashTypeTraits : WTF::GenericHashTraits<Key::HashType> {
+        static const bool emptyValueIsZero = true;
+        static void constructDeletedValue(Key::HashType& slot) { slot.fill(0xff); }
+        static bool isDeletedValue(const Key::HashType& value) { return std::all_of(value.begin(), value.end(), [](uint8_t byte) { return byte == 0xff; }); }
+    };
+    using Index = HashMap<Key::HashType, Location, HashTypeHash, HashTypeTraits>;
+
+    void openFile();
+    void closeFile();
+    bool appendEntry(const Key::HashType&, const Data* record, WallTime creationTime, WallTime accessTime, Location&);
+    void removeFromIndex(const Key::HashType&);
+
+    const String m_packFilePath;
+
+    mutable Lock m_lock;
+    int m_fileDescriptor { -1 };
+    uint64_t m_fileSize { 0 };
+    Index m_index;
+    std::atomic<size_t> m_liveSize { 0 };
+    size_t m_deadSize { 0 };
+};
+
+}
+}
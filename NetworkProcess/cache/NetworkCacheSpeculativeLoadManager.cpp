@@ -31,15 +31,20 @@
 #include "Logging.h"
 #include "NetworkCacheEntry.h"
 #include "NetworkCacheSpeculativeLoad.h"
+#include "NetworkCacheStatistics.h"
 #include "NetworkCacheSubresourcesEntry.h"
+#include "NetworkLoadParameters.h"
 #include "NetworkProcess.h"
+#include "PreconnectTask.h"
 #include <WebCore/DiagnosticLoggingKeys.h>
+#include <WebCore/SharedBuffer.h>
 #include <pal/HysteresisActivity.h>
 #include <wtf/HashCountedSet.h>
 #include <wtf/NeverDestroyed.h>
 #include <wtf/RefCounted.h>
 #include <wtf/RunLoop.h>
 #include <wtf/Seconds.h>
+#include <wtf/text/StringBuilder.h>
 
 namespace WebKit {
 
@@ -49,6 +54,17 @@ using namespace WebCore;
 
 static const Seconds preloadedEntryLifetime { 10_s };
 
+// Subresources used in fewer of the recent loads are not loaded speculatively. Going to the network is
+// more expensive than reading from the disk, so it requires a higher confidence.
+static const double minimumConfidenceToPreload = 0.5;
+static const double minimumConfidenceToRevalidate = 0.8;
+static const size_t maximumSpeculativeBytesPerLoad = 4 * 1024 * 1024;
+
+// Budgets for warming up connections to the origins a page used the last time it was loaded.
+static const unsigned maximumWarmedUpOriginsPerLoad = 6;
+static const unsigned maximumPendingConnectionWarmUps = 16;
+static const Seconds originWarmUpInterval { 10_s };
+
 #if !LOG_DISABLED
 static HashCountedSet<String>& allSpeculativeLoadingDiagnosticMessages()
 {
@@ -150,6 +166,12 @@ public:
         return WTFMove(m_entry);
     }
 
+    const Entry& cacheEntry() const
+    {
+        ASSERT(m_entry);
+        return *m_entry;
+    }
+
     const std::optional<ResourceRequest>& revalidationRequest() const { return m_speculativeValidationRequest; }
     bool wasRevalidated() const { return !!m_speculativeValidationRequest; }
 
@@ -314,11 +336,13 @@ bool SpeculativeLoadManager::canRetrieve(const Key& storageKey, const WebCore::R
         if (!canUsePreloadedEntry(*preloadedEntry, request)) {
             LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Retrieval: Could not use preloaded entry to satisfy request for '%s' due to HTTP headers mismatch:", storageKey.identifier().utf8().data());
             logSpeculativeLoadingDiagnosticMessage(frameID, preloadedEntry->wasRevalidated() ? DiagnosticLoggingKeys::wastedSpeculativeWarmupWithRevalidationKey() : DiagnosticLoggingKeys::wastedSpeculativeWarmupWithoutRevalidationKey());
+            recordSpeculativeLoadWaste(preloadedEntry->wasRevalidated(), &preloadedEntry->cacheEntry());
             return false;
         }
 
         LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Retrieval: Using preloaded entry to satisfy request for '%s':", storageKey.identifier().utf8().data());
         logSpeculativeLoadingDiagnosticMessage(frameID, preloadedEntry->wasRevalidated() ? DiagnosticLoggingKeys::successfulSpeculativeWarmupWithRevalidationKey() : DiagnosticLoggingKeys::successfulSpeculativeWarmupWithoutRevalidationKey());
+        recordSpeculativeLoadHit(preloadedEntry->wasRevalidated(), &preloadedEntry->cacheEntry());
         return true;
     }
 
@@ -336,6 +360,7 @@ bool SpeculativeLoadManager::canRetrieve(const Key& storageKey, const WebCore::R
     if (!canUsePendingPreload(*pendingPreload, request)) {
         LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Retrieval: revalidation already in progress for '%s' but unusable due to HTTP headers mismatch:", storageKey.identifier().utf8().data());
         logSpeculativeLoadingDiagnosticMessage(frameID, DiagnosticLoggingKeys::wastedSpeculativeWarmupWithRevalidationKey());
+        recordSpeculativeLoadWaste(true, nullptr);
         return false;
     }
 
@@ -382,13 +407,16 @@ void SpeculativeLoadManager::registerLoad(const GlobalFrameID& frameID, const Re
         auto pendingFrameLoad = PendingFrameLoad::create(m_storage, resourceKey, [this, frameID] {
             bool wasRemoved = m_pendingFrameLoads.remove(frameID);
             ASSERT_UNUSED(wasRemoved, wasRemoved);
+            m_speculativeLoadBudgets.remove(frameID);
         });
         m_pendingFrameLoads.add(frameID, pendingFrameLoad.copyRef());
 
         // Retrieve the subresources entry if it exists to start speculative revalidation and to update it.
-        retrieveSubresourcesEntry(resourceKey, [this, frameID, pendingFrameLoad = WTFMove(pendingFrameLoad)](std::unique_ptr<SubresourcesEntry> entry) {
-            if (entry)
+        retrieveSubresourcesEntry(resourceKey, [this, frameID, mainResourceURL = request.url(), pendingFrameLoad = WTFMove(pendingFrameLoad)](std::unique_ptr<SubresourcesEntry> entry) {
+            if (entry) {
+                warmUpConnections(frameID, mainResourceURL, *entry);
                 startSpeculativeRevalidation(frameID, *entry);
+            }
 
             pendingFrameLoad->setExistingSubresourcesEntry(WTFMove(entry));
         });
@@ -411,6 +439,7 @@ void SpeculativeLoadManager::addPreloadedEntry(std::unique_ptr<Entry> entry, con
             logSpeculativeLoadingDiagnosticMessage(frameID, DiagnosticLoggingKeys::wastedSpeculativeWarmupWithRevalidationKey());
         else
             logSpeculativeLoadingDiagnosticMessage(frameID, DiagnosticLoggingKeys::wastedSpeculativeWarmupWithoutRevalidationKey());
+        recordSpeculativeLoadWaste(preloadedEntry->wasRevalidated(), &preloadedEntry->cacheEntry());
     }));
 }
 
@@ -476,8 +505,10 @@ void SpeculativeLoadManager::revalidateSubresource(const SubresourceInfo& subres
         LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Speculative revalidation completed for '%s':", key.identifier().utf8().data());
 
         if (satisfyPendingRequests(key, revalidatedEntry.get())) {
-            if (revalidatedEntry)
+            if (revalidatedEntry) {
                 logSpeculativeLoadingDiagnosticMessage(frameID, DiagnosticLoggingKeys::successfulSpeculativeWarmupWithRevalidationKey());
+                recordSpeculativeLoadHit(true, revalidatedEntry.get());
+            }
             return;
         }
 
@@ -536,29 +567,49 @@ void SpeculativeLoadManager::preloadEntry(const Key& key, const SubresourceInfo&
         ASSERT_UNUSED(removed, removed);
 
         if (satisfyPendingRequests(key, entry.get())) {
-            if (entry)
+            if (entry) {
                 logSpeculativeLoadingDiagnosticMessage(frameID, DiagnosticLoggingKeys::successfulSpeculativeWarmupWithoutRevalidationKey());
+                recordSpeculativeLoadHit(false, entry.get());
+            }
             return;
         }
         
         if (!entry || entry->needsValidation()) {
-            if (canRevalidate(subresourceInfo, entry.get()))
+            if (subresourceInfo.confidence() < minimumConfidenceToRevalidate) {
+                LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Not revalidating '%s' because it is not used often enough (confidence=%f)", key.identifier().utf8().data(), subresourceInfo.confidence());
+                return;
+            }
+            if (canRevalidate(subresourceInfo, entry.get()) && consumeSpeculativeLoadBudget(frameID, bodySize(entry.get())))
                 revalidateSubresource(subresourceInfo, WTFMove(entry), frameID);
             return;
         }
         
-        addPreloadedEntry(WTFMove(entry), frameID);
+        if (consumeSpeculativeLoadBudget(frameID, bodySize(entry.get())))
+            addPreloadedEntry(WTFMove(entry), frameID);
     });
 }
 
 void SpeculativeLoadManager::startSpeculativeRevalidation(const GlobalFrameID& frameID, SubresourcesEntry& entry)
 {
-    for (auto& subresourceInfo : entry.subresources()) {
-        auto& key = subresourceInfo.key();
-        if (!subresourceInfo.isTransient())
-            preloadEntry(key, subresourceInfo, frameID);
+    m_speculativeLoadBudgets.set(frameID, maximumSpeculativeBytesPerLoad);
+
+    // Start with the subresources that are most likely to be used, in the order the page requested them.
+    Vector<const SubresourceInfo*> subresources;
+    subresources.reserveInitialCapacity(entry.subresources().size());
+    for (auto& subresourceInfo : entry.subresources())
+        subresources.uncheckedAppend(&subresourceInfo);
+    std::stable_sort(subresources.begin(), subresources.end(), [](auto* a, auto* b) {
+        if (a->confidence() != b->confidence())
+            return a->confidence() > b->confidence();
+        return a->position() < b->position();
+    });
+
+    for (auto* subresourceInfo : subresources) {
+        auto& key = subresourceInfo->key();
+        if (!subresourceInfo->isTransient() && subresourceInfo->confidence() >= minimumConfidenceToPreload)
+            preloadEntry(key, *subresourceInfo, frameID);
         else {
-            LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Not preloading '%s' because it is marked as transient", key.identifier().utf8().data());
+            LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Not preloading '%s' because it is marked as transient or not used often enough (confidence=%f)", key.identifier().utf8().data(), subresourceInfo->confidence());
             m_notPreloadedEntries.add(key, std::make_unique<ExpiringEntry>([this, key, frameID] {
                 logSpeculativeLoadingDiagnosticMessage(frameID, DiagnosticLoggingKeys::entryRightlyNotWarmedUpKey());
                 m_notPreloadedEntries.remove(key);
@@ -567,6 +618,129 @@ void SpeculativeLoadManager::startSpeculativeRevalidation(const GlobalFrameID& f
     }
 }
 
+static String originString(const URL& url)
+{
+    StringBuilder builder;
+    builder.append(url.protocol());
+    builder.appendLiteral("://");
+    builder.append(url.hostAndPort());
+    return builder.toString();
+}
+
+void SpeculativeLoadManager::warmUpConnections(const GlobalFrameID& frameID, const URL& mainResourceURL, const SubresourcesEntry& entry)
+{
+    struct Origin {
+        URL url;
+        ResourceLoadPriority priority;
+        unsigned subresourceCount;
+    };
+    HashMap<String, Origin> origins;
+    for (auto& subresourceInfo : entry.subresources()) {
+        if (subresourceInfo.confidence() < minimumConfidenceToPreload)
+            continue;
+        URL url { URL(), subresourceInfo.key().identifier() };
+        // The connection to the main resource origin is already being set up by the main resource load.
+        if (!url.protocolIsInHTTPFamily() || protocolHostAndPortAreEqual(url, mainResourceURL))
+            continue;
+
+        auto priority = subresourceInfo.isTransient() ? ResourceLoadPriority::Low : subresourceInfo.priority();
+        auto addResult = origins.add(originString(url), Origin { url, priority, 0 });
+        auto& origin = addResult.iterator->value;
+        origin.priority = std::max(origin.priority, priority);
+        ++origin.subresourceCount;
+    }
+    if (origins.isEmpty())
+        return;
+
+    Vector<Origin> sortedOrigins;
+    sortedOrigins.reserveInitialCapacity(origins.size());
+    for (auto& origin : origins.values())
+        sortedOrigins.uncheckedAppend(origin);
+    std::sort(sortedOrigins.begin(), sortedOrigins.end(), [](auto& a, auto& b) {
+        if (a.priority != b.priority)
+            return a.priority > b.priority;
+        return a.subresourceCount > b.subresourceCount;
+    });
+
+    auto now = MonotonicTime::now();
+    m_originWarmUpTimes.removeIf([now](auto& entry) {
+        return now - entry.value >= originWarmUpInterval;
+    });
+
+    unsigned warmedUpOriginCount = 0;
+    for (auto& origin : sortedOrigins) {
+        if (warmedUpOriginCount == maximumWarmedUpOriginsPerLoad || m_pendingConnectionWarmUpCount >= maximumPendingConnectionWarmUps)
+            break;
+        // Connections warmed up recently are still likely to be alive.
+        if (!m_originWarmUpTimes.add(originString(origin.url), now).isNewEntry)
+            continue;
+
+        LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Warming up connection to '%s' (subresources=%u)", origin.url.host().utf8().data(), origin.subresourceCount);
+        warmUpConnection(frameID, origin.url);
+        ++warmedUpOriginCount;
+    }
+}
+
+void SpeculativeLoadManager::warmUpConnection(const GlobalFrameID& frameID, const URL& url)
+{
+#if ENABLE(SERVER_PRECONNECT)
+    NetworkLoadParameters parameters;
+    parameters.webPageID = frameID.first;
+    parameters.webFrameID = frameID.second;
+    parameters.request = ResourceRequest { url };
+    parameters.sessionID = PAL::SessionID::defaultSessionID();
+    parameters.storedCredentialsPolicy = StoredCredentialsPolicy::Use;
+    parameters.shouldPreconnectOnly = PreconnectOnly::Yes;
+
+    ++m_pendingConnectionWarmUpCount;
+    new PreconnectTask(WTFMove(parameters), [this](const ResourceError&) {
+        ASSERT(m_pendingConnectionWarmUpCount);
+        --m_pendingConnectionWarmUpCount;
+    });
+#else
+    UNUSED_PARAM(frameID);
+    NetworkProcess::singleton().prefetchDNS(url.host().toString());
+#endif
+}
+
+size_t SpeculativeLoadManager::bodySize(const Entry* entry)
+{
+    if (!entry)
+        return 0;
+    // Entries read from disk would copy or map their body to create the buffer.
+    auto& body = entry->sourceStorageRecord().body;
+    if (!body.isNull())
+        return body.size();
+    auto* buffer = entry->buffer();
+    return buffer ? buffer->size() : 0;
+}
+
+bool SpeculativeLoadManager::consumeSpeculativeLoadBudget(const GlobalFrameID& frameID, size_t bytes)
+{
+    // The budget goes away with the load, speculating past that point is a waste.
+    auto it = m_speculativeLoadBudgets.find(frameID);
+    if (it == m_speculativeLoadBudgets.end())
+        return false;
+    if (bytes > it->value) {
+        LOG(NetworkCacheSpeculativePreloading, "(NetworkProcess) Speculative load budget exhausted (remaining=%zu needed=%zu)", it->value, bytes);
+        return false;
+    }
+    it->value -= bytes;
+    return true;
+}
+
+void SpeculativeLoadManager::recordSpeculativeLoadHit(bool wasRevalidated, const Entry* entry) const
+{
+    if (auto* statistics = m_cache.statistics())
+        statistics->recordSpeculativeLoadHit(wasRevalidated ? Statistics::SpeculativeLoadKind::Revalidation : Statistics::SpeculativeLoadKind::Preload, bodySize(entry));
+}
+
+void SpeculativeLoadManager::recordSpeculativeLoadWaste(bool wasRevalidated, const Entry* entry) const
+{
+    if (auto* statistics = m_cache.statistics())
+        statistics->recordSpeculativeLoadWaste(wasRevalidated ? Statistics::SpeculativeLoadKind::Revalidation : Statistics::SpeculativeLoadKind::Preload, bodySize(entry));
+}
+
 void SpeculativeLoadManager::retrieveSubresourcesEntry(const Key& storageKey, WTF::Function<void (std::unique_ptr<SubresourcesEntry>)>&& completionHandler)
 {
     ASSERT(storageKey.type() == "Resource");
@@ -32,6 +32,7 @@
 #include "NetworkCacheStorage.h"
 #include <WebCore/ResourceRequest.h>
 #include <wtf/HashMap.h>
+#include <wtf/MonotonicTime.h>
 #include <wtf/Vector.h>
 
 namespace WebKit {
@@ -66,6 +67,13 @@ private:
     bool satisfyPendingRequests(const Key&, Entry*);
     void retrieveSubresourcesEntry(const Key& storageKey, WTF::Function<void (std::unique_ptr<SubresourcesEntry>)>&&);
     void startSpeculativeRevalidation(const GlobalFrameID&, SubresourcesEntry&);
+    void warmUpConnections(const GlobalFrameID&, const WebCore::URL& mainResourceURL, const SubresourcesEntry&);
+    void warmUpConnection(const GlobalFrameID&, const WebCore::URL&);
+
+    static size_t bodySize(const Entry*);
+    bool consumeSpeculativeLoadBudget(const GlobalFrameID&, size_t bytes);
+    void recordSpeculativeLoadHit(bool wasRevalidated, const Entry*) const;
+    void recordSpeculativeLoadWaste(bool wasRevalidated, const Entry*) const;
 
     static bool canUsePreloadedEntry(const PreloadedEntry&, const WebCore::ResourceRequest& actualRequest);
     static bool canUsePendingPreload(const SpeculativeLoad&, const WebCore::ResourceRequest& actualRequest);
@@ -83,6 +91,10 @@ private:
 
     class ExpiringEntry;
     HashMap<Key, std::unique_ptr<ExpiringEntry>> m_notPreloadedEntries; // For logging.
+    HashMap<GlobalFrameID, size_t> m_speculativeLoadBudgets;
+
+    HashMap<String, MonotonicTime> m_originWarmUpTimes;
+    unsigned m_pendingConnectionWarmUpCount { 0 };
 };
 
 } // namespace NetworkCache
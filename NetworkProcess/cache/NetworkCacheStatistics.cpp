@@ -319,6 +319,32 @@ void Statistics::recordRevalidationSuccess(uint64_t webPageID, const Key& key, c
     NetworkProcess::singleton().logDiagnosticMessageWithResult(webPageID, WebCore::DiagnosticLoggingKeys::networkCacheKey(), WebCore::DiagnosticLoggingKeys::revalidatingKey(), WebCore::DiagnosticLoggingResultPass, WebCore::ShouldSample::Yes);
 }
 
+void Statistics::recordSpeculativeLoadHit(SpeculativeLoadKind kind, size_t bodySize)
+{
+    ASSERT(RunLoop::isMain());
+
+    if (kind == SpeculativeLoadKind::Revalidation)
+        ++m_speculativeLoadCounts.revalidationHitCount;
+    else
+        ++m_speculativeLoadCounts.preloadHitCount;
+    m_speculativeLoadCounts.hitBytes += bodySize;
+}
+
+void Statistics::recordSpeculativeLoadWaste(SpeculativeLoadKind kind, size_t bodySize)
+{
+    ASSERT(RunLoop::isMain());
+
+    if (kind == SpeculativeLoadKind::Revalidation)
+        ++m_speculativeLoadCounts.revalidationWasteCount;
+    else
+        ++m_speculativeLoadCounts.preloadWasteCount;
+    m_speculativeLoadCounts.wastedBytes += bodySize;
+
+    LOG(NetworkCache, "(NetworkProcess) Speculative loads: hits=%" PRIu64 "/%" PRIu64 " wasted=%" PRIu64 "/%" PRIu64 " (preloads/revalidations), hit bytes=%" PRIu64 " wasted bytes=%" PRIu64,
+        m_speculativeLoadCounts.preloadHitCount, m_speculativeLoadCounts.revalidationHitCount, m_speculativeLoadCounts.preloadWasteCount, m_speculativeLoadCounts.revalidationWasteCount,
+        m_speculativeLoadCounts.hitBytes, m_speculativeLoadCounts.wastedBytes);
+}
+
 void Statistics::markAsRequested(const String& hash)
 {
     ASSERT(RunLoop::isMain());
@@ -53,6 +53,20 @@ public:
     void recordRetrievedCachedEntry(uint64_t webPageID, const Key&, const WebCore::ResourceRequest&, UseDecision);
     void recordRevalidationSuccess(uint64_t webPageID, const Key&, const WebCore::ResourceRequest&);
 
+    enum class SpeculativeLoadKind { Preload, Revalidation };
+    void recordSpeculativeLoadHit(SpeculativeLoadKind, size_t bodySize);
+    void recordSpeculativeLoadWaste(SpeculativeLoadKind, size_t bodySize);
+
+    struct SpeculativeLoadCounts {
+        uint64_t preloadHitCount { 0 };
+        uint64_t preloadWasteCount { 0 };
+        uint64_t revalidationHitCount { 0 };
+        uint64_t revalidationWasteCount { 0 };
+        uint64_t hitBytes { 0 };
+        uint64_t wastedBytes { 0 };
+    };
+    const SpeculativeLoadCounts& speculativeLoadCounts() const { return m_speculativeLoadCounts; }
+
 private:
     WorkQueue& serialBackgroundIOQueue() { return m_serialBackgroundIOQueue.get(); }
 
@@ -84,6 +98,7 @@ private:
     WebCore::SQLiteDatabase m_database;
     HashSet<String> m_hashesToAdd;
     HashMap<String, NetworkCache::StoreDecision> m_storeDecisionsToAdd;
+    SpeculativeLoadCounts m_speculativeLoadCounts;
     WebCore::Timer m_writeTimer;
 };
 
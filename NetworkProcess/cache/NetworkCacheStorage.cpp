@@ -30,10 +30,11 @@
 #include "NetworkCacheCoders.h"
 #include "NetworkCacheFileSystem.h"
 #include "NetworkCacheIOChannel.h"
+#include "NetworkCachePackedRecordStorage.h"
+#include <errno.h>
 #include <mutex>
 #include <wtf/Condition.h>
 #include <wtf/Lock.h>
-#include <wtf/RandomNumber.h>
 #include <wtf/RunLoop.h>
 #include <wtf/text/CString.h>
 
@@ -44,17 +45,26 @@ static const char saltFileName[] = "salt";
 static const char versionDirectoryPrefix[] = "Version ";
 static const char recordsDirectoryName[] = "Records";
 static const char blobsDirectoryName[] = "Blobs";
+static const char packedRecordsFileName[] = "Records.pack";
+static const char contentsSnapshotFileName[] = "ContentsSnapshot";
+static const char temporaryFileSuffix[] = ".tmp";
 static const char blobSuffix[] = "-blob";
 constexpr size_t maximumInlineBodySize { 16 * 1024 };
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+// Smaller bodies fit in a few disk blocks either way.
+constexpr size_t minimumCompressedBodySize { 2 * 1024 };
+#endif
+constexpr unsigned maximumParallelTraverseReadCount { 5 };
 
 static double computeRecordWorth(FileTimes);
 
 struct Storage::ReadOperation {
     WTF_MAKE_FAST_ALLOCATED;
 public:
-    ReadOperation(Storage& storage, const Key& key, RetrieveCompletionHandler&& completionHandler)
+    ReadOperation(Storage& storage, const Key& key, unsigned priority, RetrieveCompletionHandler&& completionHandler)
         : storage(storage)
         , key(key)
+        , priority(priority)
         , completionHandler(WTFMove(completionHandler))
     { }
 
@@ -64,13 +74,22 @@ public:
     Ref<Storage> storage;
 
     const Key key;
+    const unsigned priority;
     const RetrieveCompletionHandler completionHandler;
-    
+
+    Lock recordChannelMutex;
+    RefPtr<IOChannel> recordChannel;
+
     std::unique_ptr<Record> resultRecord;
-    SHA1::Digest expectedBodyHash;
-    BlobStorage::Blob resultBodyBlob;
+    uint64_t expectedBodyChecksum { 0 };
+    bool isBodyBlobCompressed { false };
+    uint64_t decompressedBodySize { 0 };
+    Data resultBodyBlob;
+    uint64_t resultBodyBlobChecksum { 0 };
     std::atomic<unsigned> activeCount { 0 };
     bool isCanceled { false };
+    // The contents filter let the lookup through but there was no record on disk.
+    bool recordWasNotFound { false };
     Timings timings;
 };
 
@@ -84,6 +103,11 @@ void Storage::ReadOperation::cancel()
     timings.wasCanceled = true;
     isCanceled = true;
     completionHandler(nullptr, timings);
+
+    // Don't let a read that hasn't started yet hold up the shared I/O threads.
+    std::lock_guard<Lock> lock(recordChannelMutex);
+    if (recordChannel)
+        recordChannel->cancelPendingRead();
 }
 
 bool Storage::ReadOperation::finish()
@@ -93,8 +117,8 @@ bool Storage::ReadOperation::finish()
     if (isCanceled)
         return false;
     if (resultRecord && resultRecord->body.isNull()) {
-        if (resultBodyBlob.hash == expectedBodyHash)
-            resultRecord->body = resultBodyBlob.data;
+        if (resultBodyBlobChecksum == expectedBodyChecksum && !resultBodyBlob.isNull())
+            resultRecord->body = resultBodyBlob;
         else
             resultRecord = nullptr;
     }
@@ -156,12 +180,22 @@ static String makeBlobDirectoryPath(const String& baseDirectoryPath)
     return WebCore::FileSystem::pathByAppendingComponent(makeVersionedDirectoryPath(baseDirectoryPath), blobsDirectoryName);
 }
 
+static String makePackedRecordsFilePath(const String& baseDirectoryPath)
+{
+    return WebCore::FileSystem::pathByAppendingComponent(makeVersionedDirectoryPath(baseDirectoryPath), packedRecordsFileName);
+}
+
+static String makeContentsSnapshotFilePath(const String& baseDirectoryPath)
+{
+    return WebCore::FileSystem::pathByAppendingComponent(makeVersionedDirectoryPath(baseDirectoryPath), contentsSnapshotFileName);
+}
+
 static String makeSaltFilePath(const String& baseDirectoryPath)
 {
     return WebCore::FileSystem::pathByAppendingComponent(makeVersionedDirectoryPath(baseDirectoryPath), saltFileName);
 }
 
-RefPtr<Storage> Storage::open(const String& cachePath, Mode mode)
+RefPtr<Storage> Storage::open(const String& cachePath, Mode mode, OptionSet<Option> options)
 {
     ASSERT(RunLoop::isMain());
 
@@ -170,7 +204,7 @@ RefPtr<Storage> Storage::open(const String& cachePath, Mode mode)
     auto salt = readOrMakeSalt(makeSaltFilePath(cachePath));
     if (!salt)
         return nullptr;
-    return adoptRef(new Storage(cachePath, mode, *salt));
+    return adoptRef(new Storage(cachePath, mode, options, *salt));
 }
 
 void traverseRecordsFiles(const String& recordsPath, const String& expectedType, const RecordFileTraverseFunction& function)
@@ -219,7 +253,7 @@ static void deleteEmptyRecordsDirectories(const String& recordsPath)
     });
 }
 
-Storage::Storage(const String& baseDirectoryPath, Mode mode, Salt salt)
+Storage::Storage(const String& baseDirectoryPath, Mode mode, OptionSet<Option> options, Salt salt)
     : m_basePath(baseDirectoryPath)
     , m_recordsPath(makeRecordsDirectoryPath(baseDirectoryPath))
     , m_mode(mode)
@@ -227,13 +261,18 @@ Storage::Storage(const String& baseDirectoryPath, Mode mode, Salt salt)
     , m_canUseBlobsForForBodyData(isSafeToUseMemoryMapForPath(baseDirectoryPath))
     , m_readOperationTimeoutTimer(*this, &Storage::cancelAllReadOperations)
     , m_writeOperationDispatchTimer(*this, &Storage::dispatchPendingWriteOperations)
+    , m_contentsSnapshotTimer(*this, &Storage::contentsSnapshotTimerFired)
     , m_ioQueue(WorkQueue::create("com.apple.WebKit.Cache.Storage", WorkQueue::Type::Concurrent))
     , m_backgroundIOQueue(WorkQueue::create("com.apple.WebKit.Cache.Storage.background", WorkQueue::Type::Concurrent, WorkQueue::QOS::Background))
     , m_serialBackgroundIOQueue(WorkQueue::create("com.apple.WebKit.Cache.Storage.serialBackground", WorkQueue::Type::Serial, WorkQueue::QOS::Background))
     , m_blobStorage(makeBlobDirectoryPath(baseDirectoryPath), m_salt)
 {
+    if (options.contains(Option::PackedRecords))
+        m_packedRecordStorage = std::make_unique<PackedRecordStorage>(makePackedRecordsFilePath(baseDirectoryPath));
+
     deleteOldVersions();
-    synchronize();
+    if (!restoreContentsSnapshot())
+        synchronize();
 }
 
 Storage::~Storage()
@@ -284,12 +323,17 @@ void Storage::synchronize()
 
     LOG(NetworkCacheStorage, "(NetworkProcess) synchronizing cache");
 
-    backgroundIOQueue().dispatch([this, protectedThis = makeRef(*this)] () mutable {
-        auto recordFilter = std::make_unique<ContentsFilter>();
-        auto blobFilter = std::make_unique<ContentsFilter>();
+    size_t recordCountHint = std::max(m_recordCountHint, m_recordFilter ? m_recordFilter->entryCount() : 0);
+    size_t blobCountHint = std::max(m_blobCountHint, m_blobFilter ? m_blobFilter->entryCount() : 0);
+
+    // Eviction measures the records it goes through, an estimate is enough to decide when to start one.
+    bool shouldComputeExactRecordsSize = !m_canUseBlobsForForBodyData;
+
+    backgroundIOQueue().dispatch([this, protectedThis = makeRef(*this), recordCountHint, blobCountHint, shouldComputeExactRecordsSize] () mutable {
+        auto recordFilter = std::make_unique<ContentsFilter>(recordCountHint);
+        auto blobFilter = std::make_unique<ContentsFilter>(blobCountHint);
 
         // Most of the disk space usage is in blobs if we are using them. Approximate records file sizes to avoid expensive stat() calls.
-        bool shouldComputeExactRecordsSize = !m_canUseBlobsForForBodyData;
         size_t recordsSize = 0;
         unsigned recordCount = 0;
         unsigned blobCount = 0;
@@ -324,7 +368,16 @@ void Storage::synchronize()
         if (!shouldComputeExactRecordsSize)
             recordsSize = estimateRecordsSize(recordCount, blobCount);
 
-        RunLoop::main().dispatch([this, recordFilter = WTFMove(recordFilter), blobFilter = WTFMove(blobFilter), recordsSize]() mutable {
+        if (m_packedRecordStorage) {
+            m_packedRecordStorage->synchronize([&](const Key::HashType& hash) {
+                ++recordCount;
+                recordFilter->add(hash);
+            });
+            m_packedRecordStorage->compactIfNeeded();
+            recordsSize += m_packedRecordStorage->approximateSize();
+        }
+
+        RunLoop::main().dispatch([this, recordFilter = WTFMove(recordFilter), blobFilter = WTFMove(blobFilter), recordsSize, recordCount, blobCount]() mutable {
             for (auto& recordFilterKey : m_recordFilterHashesAddedDuringSynchronization)
                 recordFilter->add(recordFilterKey);
             m_recordFilterHashesAddedDuringSynchronization.clear();
@@ -333,10 +386,23 @@ void Storage::synchronize()
                 blobFilter->add(hash);
             m_blobFilterHashesAddedDuringSynchronization.clear();
 
+            bool filtersOverflowed = recordFilter->hasOverflowed() || blobFilter->hasOverflowed();
+
             m_recordFilter = WTFMove(recordFilter);
             m_blobFilter = WTFMove(blobFilter);
+            m_recordCountHint = recordCount;
+            m_blobCountHint = blobCount;
             m_approximateRecordsSize = recordsSize;
             m_synchronizationInProgress = false;
+
+            // Now that the real counts are known, the rebuilt filters get sized to fit.
+            if (filtersOverflowed) {
+                LOG(NetworkCacheStorage, "(NetworkProcess) contents filter overflowed, resynchronizing");
+                synchronize();
+                return;
+            }
+
+            scheduleContentsSnapshot();
         });
 
         m_blobStorage.synchronize();
@@ -349,6 +415,185 @@ void Storage::synchronize()
     });
 }
 
+struct ContentsSnapshot {
+    bool isFinal { false };
+    WallTime writeTime;
+    uint64_t recordsSize { 0 };
+    uint64_t blobsSize { 0 };
+    std::unique_ptr<ContentsFilter> recordFilter;
+    std::unique_ptr<ContentsFilter> blobFilter;
+};
+
+static Data encodeContentsSnapshot(const ContentsSnapshot& snapshot)
+{
+    WTF::Persistence::Encoder encoder;
+
+    encoder << Storage::version;
+    encoder << snapshot.isFinal;
+    encoder << snapshot.writeTime;
+    encoder << snapshot.recordsSize;
+    encoder << snapshot.blobsSize;
+    snapshot.recordFilter->encode(encoder);
+    snapshot.blobFilter->encode(encoder);
+
+    encoder.encodeChecksum();
+
+    return Data(encoder.buffer(), encoder.bufferSize());
+}
+
+static std::optional<ContentsSnapshot> decodeContentsSnapshot(const Data& snapshotData)
+{
+    if (snapshotData.isNull())
+        return std::nullopt;
+
+    WTF::Persistence::Decoder decoder(snapshotData.data(), snapshotData.size());
+
+    unsigned version;
+    if (!decoder.decode(version) || version != Storage::version)
+        return std::nullopt;
+
+    ContentsSnapshot snapshot;
+    if (!decoder.decode(snapshot.isFinal))
+        return std::nullopt;
+    if (!decoder.decode(snapshot.writeTime))
+        return std::nullopt;
+    if (!decoder.decode(snapshot.recordsSize))
+        return std::nullopt;
+    if (!decoder.decode(snapshot.blobsSize))
+        return std::nullopt;
+    snapshot.recordFilter = std::make_unique<ContentsFilter>();
+    if (!ContentsFilter::decode(decoder, *snapshot.recordFilter))
+        return std::nullopt;
+    snapshot.blobFilter = std::make_unique<ContentsFilter>();
+    if (!ContentsFilter::decode(decoder, *snapshot.blobFilter))
+        return std::nullopt;
+    if (!decoder.verifyChecksum())
+        return std::nullopt;
+
+    return WTFMove(snapshot);
+}
+
+bool Storage::restoreContentsSnapshot()
+{
+    ASSERT(RunLoop::isMain());
+
+    // The snapshot is small, read it synchronously like the salt so that lookups can use the filters right away.
+    auto snapshotPath = makeContentsSnapshotFilePath(basePath());
+    auto snapshot = decodeContentsSnapshot(mapFile(WebCore::FileSystem::fileSystemRepresentation(snapshotPath).data()));
+    if (!snapshot) {
+        LOG(NetworkCacheStorage, "(NetworkProcess) no valid contents snapshot");
+        return false;
+    }
+
+    m_recordFilter = WTFMove(snapshot->recordFilter);
+    m_blobFilter = WTFMove(snapshot->blobFilter);
+    m_recordCountHint = m_recordFilter->entryCount();
+    m_blobCountHint = m_blobFilter->entryCount();
+    m_approximateRecordsSize = snapshot->recordsSize;
+    m_blobStorage.setApproximateSize(snapshot->blobsSize);
+
+    // A snapshot can't be trusted twice, delete it so that a crash before the next one triggers a full synchronization.
+    serialBackgroundIOQueue().dispatch([snapshotPath = snapshotPath.isolatedCopy()] {
+        WebCore::FileSystem::deleteFile(snapshotPath);
+    });
+
+    const Seconds maximumSnapshotAge = 7 * 24_h;
+    auto snapshotAge = WallTime::now() - snapshot->writeTime;
+    bool isStale = !snapshot->isFinal || snapshotAge < 0_s || snapshotAge > maximumSnapshotAge;
+
+    LOG(NetworkCacheStorage, "(NetworkProcess) restored contents snapshot final=%d age=%f stale=%d", snapshot->isFinal, snapshotAge.seconds(), isStale);
+
+    if (isStale)
+        return false;
+
+    // The filter already knows about the packed records, but until their index is loaded a read would miss them
+    // and remove a valid record. Removals and access time updates go through the serial queue so they are ordered
+    // after the load, reads and writes are held in the pending queues until it completes.
+    m_packedRecordIndexLoadInProgress = !!m_packedRecordStorage;
+
+    serialBackgroundIOQueue().dispatch([this, protectedThis = makeRef(*this)] () mutable {
+        if (m_packedRecordStorage) {
+            m_packedRecordStorage->synchronize([](const Key::HashType&) { });
+            RunLoop::main().dispatch([this, protectedThis = protectedThis.copyRef()] {
+                m_packedRecordIndexLoadInProgress = false;
+                dispatchPendingReadOperations();
+                dispatchPendingWriteOperations();
+                shrinkIfNeeded();
+            });
+        }
+
+        // Blob sizes and unreferenced blobs are not part of the snapshot.
+        m_blobStorage.synchronize();
+
+        RunLoop::main().dispatch([protectedThis = WTFMove(protectedThis)] { });
+    });
+    return true;
+}
+
+void Storage::writeContentsSnapshot(SnapshotType type, Function<void ()>&& completionHandler)
+{
+    ASSERT(RunLoop::isMain());
+
+    m_contentsSnapshotTimer.stop();
+
+    if (!m_recordFilter || !m_blobFilter) {
+        if (completionHandler)
+            completionHandler();
+        return;
+    }
+
+    // Filters are not complete until the synchronization finishes.
+    bool isFinal = type == SnapshotType::Final && !m_synchronizationInProgress;
+    m_hasFinalContentsSnapshot = isFinal;
+
+    ContentsSnapshot snapshot;
+    snapshot.isFinal = isFinal;
+    snapshot.writeTime = WallTime::now();
+    snapshot.recordsSize = m_approximateRecordsSize;
+    snapshot.blobsSize = m_blobStorage.approximateSize();
+    snapshot.recordFilter = std::make_unique<ContentsFilter>(*m_recordFilter);
+    snapshot.blobFilter = std::make_unique<ContentsFilter>(*m_blobFilter);
+
+    serialBackgroundIOQueue().dispatch([this, protectedThis = makeRef(*this), snapshot = WTFMove(snapshot), completionHandler = WTFMove(completionHandler)] () mutable {
+        auto snapshotPath = makeContentsSnapshotFilePath(basePath());
+        auto temporaryPath = snapshotPath + temporaryFileSuffix;
+        WebCore::FileSystem::deleteFile(temporaryPath);
+
+        auto snapshotData = encodeContentsSnapshot(snapshot);
+        if (!snapshotData.mapToFile(WebCore::FileSystem::fileSystemRepresentation(temporaryPath).data()).isNull())
+            WebCore::FileSystem::moveFile(temporaryPath, snapshotPath);
+
+        LOG(NetworkCacheStorage, "(NetworkProcess) wrote contents snapshot final=%d", snapshot.isFinal);
+
+        RunLoop::main().dispatch([protectedThis = WTFMove(protectedThis), completionHandler = WTFMove(completionHandler)] {
+            if (completionHandler)
+                completionHandler();
+        });
+    });
+}
+
+void Storage::scheduleContentsSnapshot()
+{
+    ASSERT(RunLoop::isMain());
+
+    // Make sure an outdated final snapshot is never used.
+    if (m_hasFinalContentsSnapshot) {
+        writeContentsSnapshot(SnapshotType::Checkpoint, { });
+        return;
+    }
+
+    if (m_contentsSnapshotTimer.isActive())
+        return;
+
+    const Seconds contentsSnapshotInterval = 5_min;
+    m_contentsSnapshotTimer.startOneShot(contentsSnapshotInterval);
+}
+
+void Storage::contentsSnapshotTimerFired()
+{
+    writeContentsSnapshot(SnapshotType::Checkpoint, { });
+}
+
 void Storage::addToRecordFilter(const Key& key)
 {
     ASSERT(RunLoop::isMain());
@@ -359,6 +604,70 @@ void Storage::addToRecordFilter(const Key& key)
     // If we get new entries during filter synchronization take care to add them to the new filter as well.
     if (m_synchronizationInProgress)
         m_recordFilterHashesAddedDuringSynchronization.append(key.hash());
+
+    scheduleContentsSnapshot();
+
+    if (m_recordFilter && m_recordFilter->hasOverflowed())
+        synchronize();
+}
+
+void Storage::addToBlobFilter(const Key& key)
+{
+    ASSERT(RunLoop::isMain());
+
+    if (m_blobFilter)
+        m_blobFilter->add(key.hash());
+    if (m_synchronizationInProgress)
+        m_blobFilterHashesAddedDuringSynchronization.append(key.hash());
+
+    scheduleContentsSnapshot();
+
+    if (m_blobFilter && m_blobFilter->hasOverflowed())
+        synchronize();
+}
+
+bool Storage::hasWriteOperation(const Key::HashType& hash) const
+{
+    auto isForHash = [&hash](auto& operation) {
+        return operation->record.key.hash() == hash;
+    };
+    return std::any_of(m_pendingWriteOperations.begin(), m_pendingWriteOperations.end(), isForHash)
+        || std::any_of(m_activeWriteOperations.begin(), m_activeWriteOperations.end(), isForHash);
+}
+
+void Storage::removeFromContentsFilters(const Key::HashType& hash, bool removeRecord, bool removeBlob)
+{
+    ASSERT(RunLoop::isMain());
+
+    // Only remove hashes that were known to be on disk, otherwise the filter could forget another entry with the same fingerprint.
+    // A store that got started after the deletion has already added the hash back.
+    if (hasWriteOperation(hash))
+        return;
+
+    if (removeRecord && m_recordFilter)
+        m_recordFilter->remove(hash);
+    if (removeBlob && m_blobFilter)
+        m_blobFilter->remove(hash);
+
+    // An entry being synchronized may still get added to the new filters. That only costs a false positive.
+    if (removeRecord || removeBlob)
+        scheduleContentsSnapshot();
+}
+
+Storage::ContentsFilterStatistics Storage::contentsFilterStatistics() const
+{
+    ASSERT(RunLoop::isMain());
+
+    ContentsFilterStatistics statistics;
+    statistics.lookupCount = m_contentsFilterLookupCount;
+    statistics.filteredLookupCount = m_contentsFilterFilteredLookupCount;
+    statistics.falsePositiveCount = m_contentsFilterFalsePositiveCount;
+    if (m_recordFilter) {
+        statistics.recordCount = m_recordFilter->entryCount();
+        statistics.capacity = m_recordFilter->capacity();
+        statistics.expectedFalsePositiveRate = m_recordFilter->expectedFalsePositiveRate();
+    }
+    return statistics;
 }
 
 bool Storage::mayContain(const Key& key) const
@@ -396,6 +705,26 @@ String Storage::blobPathForKey(const Key& key) const
     return blobPathForRecordPath(recordPathForKey(key));
 }
 
+enum class BodyCompression : uint8_t {
+    None,
+    Deflate,
+};
+
+static bool isSupportedBodyCompression(BodyCompression compression)
+{
+    switch (compression) {
+    case BodyCompression::None:
+        return true;
+    case BodyCompression::Deflate:
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
 struct RecordMetaData {
     RecordMetaData() { }
     explicit RecordMetaData(const Key& key)
@@ -406,11 +735,16 @@ struct RecordMetaData {
     unsigned cacheStorageVersion;
     Key key;
     WallTime timeStamp;
-    SHA1::Digest headerHash;
+    uint64_t headerChecksum { 0 };
     uint64_t headerSize { 0 };
+    // Identifies the body, only the checksum is used to verify it.
     SHA1::Digest bodyHash;
+    uint64_t bodyChecksum { 0 };
+    // Size of the body as stored. The hash and the checksum cover the stored bytes too.
     uint64_t bodySize { 0 };
     bool isBodyInline { false };
+    BodyCompression bodyCompression { BodyCompression::None };
+    uint64_t decompressedBodySize { 0 };
 
     // Not encoded as a field. Header starts immediately after meta data.
     uint64_t headerOffset { 0 };
@@ -427,16 +761,22 @@ static bool decodeRecordMetaData(RecordMetaData& metaData, const Data& fileData)
             return false;
         if (!decoder.decode(metaData.timeStamp))
             return false;
-        if (!decoder.decode(metaData.headerHash))
+        if (!decoder.decode(metaData.headerChecksum))
             return false;
         if (!decoder.decode(metaData.headerSize))
             return false;
         if (!decoder.decode(metaData.bodyHash))
             return false;
+        if (!decoder.decode(metaData.bodyChecksum))
+            return false;
         if (!decoder.decode(metaData.bodySize))
             return false;
         if (!decoder.decode(metaData.isBodyInline))
             return false;
+        if (!decoder.decodeEnum(metaData.bodyCompression))
+            return false;
+        if (!decoder.decode(metaData.decompressedBodySize))
+            return false;
         if (!decoder.verifyChecksum())
             return false;
         metaData.headerOffset = decoder.currentOffset();
@@ -458,8 +798,13 @@ static bool decodeRecordHeader(const Data& fileData, RecordMetaData& metaData, D
         return false;
     }
 
+    if (!isSupportedBodyCompression(metaData.bodyCompression)) {
+        LOG(NetworkCacheStorage, "(NetworkProcess) unsupported body compression");
+        return false;
+    }
+
     headerData = fileData.subrange(metaData.headerOffset, metaData.headerSize);
-    if (metaData.headerHash != computeSHA1(headerData, salt)) {
+    if (metaData.headerChecksum != computeChecksum(headerData, salt)) {
         LOG(NetworkCacheStorage, "(NetworkProcess) header checksum mismatch");
         return false;
     }
@@ -488,11 +833,20 @@ void Storage::readRecord(ReadOperation& readOperation, const Data& recordData)
         if (bodyOffset + metaData.bodySize != recordData.size())
             return;
         bodyData = recordData.subrange(bodyOffset, metaData.bodySize);
-        if (metaData.bodyHash != computeSHA1(bodyData, m_salt))
+        if (metaData.bodyChecksum != computeChecksum(bodyData, m_salt))
             return;
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+        if (metaData.bodyCompression == BodyCompression::Deflate) {
+            bodyData = decompressData(bodyData, metaData.decompressedBodySize);
+            if (bodyData.isNull())
+                return;
+        }
+#endif
     }
 
-    readOperation.expectedBodyHash = metaData.bodyHash;
+    readOperation.expectedBodyChecksum = metaData.bodyChecksum;
+    readOperation.isBodyBlobCompressed = !metaData.isBodyInline && metaData.bodyCompression != BodyCompression::None;
+    readOperation.decompressedBodySize = metaData.decompressedBodySize;
     readOperation.resultRecord = std::make_unique<Storage::Record>(Storage::Record {
         metaData.key,
         metaData.timeStamp,
@@ -509,59 +863,69 @@ static Data encodeRecordMetaData(const RecordMetaData& metaData)
     encoder << metaData.cacheStorageVersion;
     encoder << metaData.key;
     encoder << metaData.timeStamp;
-    encoder << metaData.headerHash;
+    encoder << metaData.headerChecksum;
     encoder << metaData.headerSize;
     encoder << metaData.bodyHash;
+    encoder << metaData.bodyChecksum;
     encoder << metaData.bodySize;
     encoder << metaData.isBodyInline;
+    encoder.encodeEnum(metaData.bodyCompression);
+    encoder << metaData.decompressedBodySize;
 
     encoder.encodeChecksum();
 
     return Data(encoder.buffer(), encoder.bufferSize());
 }
 
-std::optional<BlobStorage::Blob> Storage::storeBodyAsBlob(WriteOperation& writeOperation)
+std::optional<BlobStorage::Blob> Storage::storeBodyAsBlob(WriteOperation& writeOperation, const Data& compressedBody)
 {
     auto blobPath = blobPathForKey(writeOperation.record.key);
+    bool blobExisted = WebCore::FileSystem::fileExists(blobPath);
 
-    // Store the body.
-    auto blob = m_blobStorage.add(blobPath, writeOperation.record.body);
+    // Store the body. Compression is deterministic so identical bodies still share a blob.
+    bool isBodyCompressed = !compressedBody.isNull();
+    auto blob = m_blobStorage.add(blobPath, isBodyCompressed ? compressedBody : writeOperation.record.body);
     if (blob.data.isNull())
         return { };
 
     ++writeOperation.activeCount;
 
-    RunLoop::main().dispatch([this, blob, &writeOperation] {
-        if (m_blobFilter)
-            m_blobFilter->add(writeOperation.record.key.hash());
-        if (m_synchronizationInProgress)
-            m_blobFilterHashesAddedDuringSynchronization.append(writeOperation.record.key.hash());
+    RunLoop::main().dispatch([this, blob, isBodyCompressed, blobExisted, &writeOperation] {
+        if (!blobExisted)
+            addToBlobFilter(writeOperation.record.key);
 
+        // A compressed blob can't be mapped by clients, hand out the plain body instead.
         if (writeOperation.mappedBodyHandler)
-            writeOperation.mappedBodyHandler(blob.data);
+            writeOperation.mappedBodyHandler(isBodyCompressed ? writeOperation.record.body : blob.data);
 
         finishWriteOperation(writeOperation);
     });
     return blob;
 }
 
-Data Storage::encodeRecord(const Record& record, std::optional<BlobStorage::Blob> blob)
+Data Storage::encodeRecord(const Record& record, const Data& compressedBody, std::optional<BlobStorage::Blob> blob)
 {
-    ASSERT(!blob || bytesEqual(blob.value().data, record.body));
+    bool isBodyCompressed = !compressedBody.isNull();
+    auto& storedBody = isBodyCompressed ? compressedBody : record.body;
+
+    ASSERT(!blob || bytesEqual(blob.value().data, storedBody));
 
     RecordMetaData metaData(record.key);
     metaData.timeStamp = record.timeStamp;
-    metaData.headerHash = computeSHA1(record.header, m_salt);
+    metaData.headerChecksum = computeChecksum(record.header, m_salt);
     metaData.headerSize = record.header.size();
-    metaData.bodyHash = blob ? blob.value().hash : computeSHA1(record.body, m_salt);
-    metaData.bodySize = record.body.size();
+    metaData.bodyHash = blob ? blob.value().hash : computeSHA1(storedBody, m_salt);
+    metaData.bodyChecksum = blob ? blob.value().checksum : computeChecksum(storedBody, m_salt);
+    metaData.bodySize = storedBody.size();
     metaData.isBodyInline = !blob;
+    metaData.bodyCompression = isBodyCompressed ? BodyCompression::Deflate : BodyCompression::None;
+    metaData.decompressedBodySize = record.body.size();
 
     auto encodedMetaData = encodeRecordMetaData(metaData);
     auto headerData = concatenate(encodedMetaData, record.header);
 
     if (metaData.isBodyInline)
-        return concatenate(headerData, record.body);
+        return concatenate(headerData, storedBody);
 
     return { headerData };
 }
@@ -584,20 +948,22 @@ void Storage::remove(const Key& key)
 {
     ASSERT(RunLoop::isMain());
 
-    if (!mayContain(key))
+    removeFromPendingWriteOperations(key);
+
+    // An active write only adds the key to the filter when it completes.
+    if (!mayContain(key) && !hasWriteOperation(key.hash()))
         return;
 
     auto protectedThis = makeRef(*this);
 
-    // We can't remove the key from the Bloom filter (but some false positives are expected anyway).
-    // For simplicity we also don't reduce m_approximateSize on removals.
-    // The next synchronization will update everything.
-
-    removeFromPendingWriteOperations(key);
+    // For simplicity we don't reduce m_approximateSize on removals.
+    // The next synchronization will update it.
 
     serialBackgroundIOQueue().dispatch([this, protectedThis = WTFMove(protectedThis), key] () mutable {
-        deleteFiles(key);
-        RunLoop::main().dispatch([protectedThis = WTFMove(protectedThis)] { });
+        auto deletedFiles = deleteFiles(key);
+        RunLoop::main().dispatch([this, protectedThis = WTFMove(protectedThis), hash = key.hash(), deletedFiles] {
+            didRemoveRecords({ { hash, deletedFiles } });
+        });
     });
 }
 
@@ -609,35 +975,61 @@ void Storage::remove(const Vector<Key>& keys, Function<void ()>&& completionHand
     keysToRemove.reserveInitialCapacity(keys.size());
 
     for (auto& key : keys) {
-        if (!mayContain(key))
-            continue;
         removeFromPendingWriteOperations(key);
+        if (!mayContain(key) && !hasWriteOperation(key.hash()))
+            continue;
         keysToRemove.uncheckedAppend(key);
     }
 
     serialBackgroundIOQueue().dispatch([this, protectedThis = makeRef(*this), keysToRemove = WTFMove(keysToRemove), completionHandler = WTFMove(completionHandler)] () mutable {
+        Vector<std::pair<Key::HashType, DeletedFiles>> deletedFilesForKeys;
+        deletedFilesForKeys.reserveInitialCapacity(keysToRemove.size());
         for (auto& key : keysToRemove)
-            deleteFiles(key);
+            deletedFilesForKeys.uncheckedAppend({ key.hash(), deleteFiles(key) });
 
-        RunLoop::main().dispatch([protectedThis = WTFMove(protectedThis), completionHandler = WTFMove(completionHandler)] {
+        RunLoop::main().dispatch([this, protectedThis = WTFMove(protectedThis), deletedFilesForKeys = WTFMove(deletedFilesForKeys), completionHandler = WTFMove(completionHandler)] {
+            didRemoveRecords(deletedFilesForKeys);
             if (completionHandler)
                 completionHandler();
         });
     });
 }
 
-void Storage::deleteFiles(const Key& key)
+void Storage::didRemoveRecords(const Vector<std::pair<Key::HashType, DeletedFiles>>& deletedFilesForHashes)
+{
+    ASSERT(RunLoop::isMain());
+
+    Vector<Key::HashType> removedRecordHashes;
+    for (auto& deletedFiles : deletedFilesForHashes) {
+        removeFromContentsFilters(deletedFiles.first, deletedFiles.second.record, deletedFiles.second.blob);
+        if (deletedFiles.second.record)
+            removedRecordHashes.append(deletedFiles.first);
+    }
+
+    if (m_recordsRemovedHandler && !removedRecordHashes.isEmpty())
+        m_recordsRemovedHandler(removedRecordHashes);
+}
+
+Storage::DeletedFiles Storage::deleteFiles(const Key& key)
 {
     ASSERT(!RunLoop::isMain());
 
-    WebCore::FileSystem::deleteFile(recordPathForKey(key));
-    m_blobStorage.remove(blobPathForKey(key));
+    DeletedFiles deletedFiles;
+    deletedFiles.record = WebCore::FileSystem::deleteFile(recordPathForKey(key));
+    if (m_packedRecordStorage && m_packedRecordStorage->remove(key.hash()))
+        deletedFiles.record = true;
+    deletedFiles.blob = m_blobStorage.remove(blobPathForKey(key));
+    return deletedFiles;
 }
 
-void Storage::updateFileModificationTime(const String& path)
+void Storage::updateRecordAccessTime(const Key& key)
 {
-    serialBackgroundIOQueue().dispatch([path = path.isolatedCopy()] {
-        updateFileModificationTimeIfNeeded(path);
+    serialBackgroundIOQueue().dispatch([this, protectedThis = makeRef(*this), hash = key.hash(), path = recordPathForKey(key).isolatedCopy()] () mutable {
+        if (m_packedRecordStorage && m_packedRecordStorage->contains(hash))
+            m_packedRecordStorage->updateAccessTime(hash);
+        else
+            updateFileModificationTimeIfNeeded(path);
+        RunLoop::main().dispatch([protectedThis = WTFMove(protectedThis)] { });
     });
 }
 
@@ -673,13 +1065,31 @@ void Storage::dispatchReadOperation(std::unique_ptr<ReadOperation> readOperation
 
         readOperation.timings.recordIOStartTime = MonotonicTime::now();
 
-        auto channel = IOChannel::open(recordPath, IOChannel::Type::Read);
-        channel->read(0, std::numeric_limits<size_t>::max(), &ioQueue(), [this, &readOperation](const Data& fileData, int error) {
+        auto packedRecordData = m_packedRecordStorage ? m_packedRecordStorage->get(readOperation.key.hash()) : Data { };
+        if (!packedRecordData.isNull()) {
             readOperation.timings.recordIOEndTime = MonotonicTime::now();
-            if (!error)
-                readRecord(readOperation, fileData);
+            readRecord(readOperation, packedRecordData);
             finishReadOperation(readOperation);
-        });
+        } else {
+            auto channel = IOChannel::open(recordPath, IOChannel::Type::Read);
+            channel->setReadPriority(readOperation.priority);
+            {
+                std::lock_guard<Lock> lock(readOperation.recordChannelMutex);
+                readOperation.recordChannel = channel.copyRef();
+            }
+            channel->read(0, std::numeric_limits<size_t>::max(), &ioQueue(), [this, &readOperation](const Data& fileData, int error) {
+                readOperation.timings.recordIOEndTime = MonotonicTime::now();
+                {
+                    std::lock_guard<Lock> lock(readOperation.recordChannelMutex);
+                    readOperation.recordChannel = nullptr;
+                }
+                if (!error)
+                    readRecord(readOperation, fileData);
+                else if (error != ECANCELED)
+                    readOperation.recordWasNotFound = true;
+                finishReadOperation(readOperation);
+            });
+        }
 
         if (shouldGetBodyBlob) {
             // Read the blob in parallel with the record read.
@@ -687,6 +1097,7 @@ void Storage::dispatchReadOperation(std::unique_ptr<ReadOperation> readOperation
 
             auto blobPath = blobPathForKey(readOperation.key);
             readOperation.resultBodyBlob = m_blobStorage.get(blobPath);
+            readOperation.resultBodyBlobChecksum = computeChecksum(readOperation.resultBodyBlob, m_salt);
 
             readOperation.timings.blobIOEndTime = MonotonicTime::now();
 
@@ -702,10 +1113,19 @@ void Storage::finishReadOperation(ReadOperation& readOperation)
     if (--readOperation.activeCount)
         return;
 
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+    // Decompress on the I/O queue while both reads are known to be done.
+    if (readOperation.resultRecord && readOperation.isBodyBlobCompressed && readOperation.resultBodyBlobChecksum == readOperation.expectedBodyChecksum)
+        readOperation.resultBodyBlob = decompressData(readOperation.resultBodyBlob, readOperation.decompressedBodySize);
+#endif
+
     RunLoop::main().dispatch([this, &readOperation] {
+        if (readOperation.recordWasNotFound && !readOperation.isCanceled)
+            ++m_contentsFilterFalsePositiveCount;
+
         bool success = readOperation.finish();
         if (success)
-            updateFileModificationTime(recordPathForKey(readOperation.key));
+            updateRecordAccessTime(readOperation.key);
         else if (!readOperation.isCanceled)
             remove(readOperation.key);
 
@@ -748,6 +1168,11 @@ void Storage::dispatchPendingReadOperations()
 
     const int maximumActiveReadOperationCount = 5;
 
+    if (m_packedRecordIndexLoadInProgress) {
+        LOG(NetworkCacheStorage, "(NetworkProcess) holding retrieves until the packed record index is loaded");
+        return;
+    }
+
     for (int priority = maximumRetrievePriority; priority >= 0; --priority) {
         if (m_activeReadOperations.size() > maximumActiveReadOperationCount) {
             LOG(NetworkCacheStorage, "(NetworkProcess) limiting parallel retrieves");
@@ -780,6 +1205,10 @@ void Storage::dispatchPendingWriteOperations()
 
     const int maximumActiveWriteOperationCount { 1 };
 
+    // A write may need to remove an older packed version of the record, which only works once the index is loaded.
+    if (m_packedRecordIndexLoadInProgress)
+        return;
+
     while (!m_pendingWriteOperations.isEmpty()) {
         if (m_activeWriteOperations.size() >= maximumActiveWriteOperationCount) {
             LOG(NetworkCacheStorage, "(NetworkProcess) limiting parallel writes");
@@ -789,6 +1218,18 @@ void Storage::dispatchPendingWriteOperations()
     }
 }
 
+static Data compressBodyIfNeeded(const Storage::Record& record)
+{
+#if ENABLE(NETWORK_CACHE_COMPRESSION)
+    if (!record.shouldCompressBody || record.body.size() < minimumCompressedBodySize)
+        return { };
+    return compressData(record.body);
+#else
+    UNUSED_PARAM(record);
+    return { };
+#endif
+}
+
 bool Storage::shouldStoreBodyAsBlob(const Data& bodyData)
 {
     if (!m_canUseBlobsForForBodyData)
@@ -796,6 +1237,13 @@ bool Storage::shouldStoreBodyAsBlob(const Data& bodyData)
     return bodyData.size() > maximumInlineBodySize;
 }
 
+bool Storage::shouldStoreRecordPacked(const Data& recordData)
+{
+    if (!m_packedRecordStorage)
+        return false;
+    return recordData.size() <= PackedRecordStorage::maximumRecordSize;
+}
+
 void Storage::dispatchWriteOperation(std::unique_ptr<WriteOperation> writeOperationPtr)
 {
     ASSERT(RunLoop::isMain());
@@ -803,26 +1251,48 @@ void Storage::dispatchWriteOperation(std::unique_ptr<WriteOperation> writeOperat
     auto& writeOperation = *writeOperationPtr;
     m_activeWriteOperations.add(WTFMove(writeOperationPtr));
 
-    // This was added already when starting the store but filter might have been wiped.
-    addToRecordFilter(writeOperation.record.key);
-
     backgroundIOQueue().dispatch([this, &writeOperation] {
         auto recordDirectorPath = recordDirectoryPathForKey(writeOperation.record.key);
         auto recordPath = recordPathForKey(writeOperation.record.key);
 
         WebCore::FileSystem::makeAllDirectories(recordDirectorPath);
 
+        // The contents filters count copies, only a record that is new on disk gets added.
+        bool recordExisted = WebCore::FileSystem::fileExists(recordPath) || (m_packedRecordStorage && m_packedRecordStorage->contains(writeOperation.record.key.hash()));
+
         ++writeOperation.activeCount;
 
-        bool shouldStoreAsBlob = shouldStoreBodyAsBlob(writeOperation.record.body);
-        auto blob = shouldStoreAsBlob ? storeBodyAsBlob(writeOperation) : std::nullopt;
+        auto compressedBody = compressBodyIfNeeded(writeOperation.record);
 
-        auto recordData = encodeRecord(writeOperation.record, blob);
+        bool shouldStoreAsBlob = shouldStoreBodyAsBlob(compressedBody.isNull() ? writeOperation.record.body : compressedBody);
+        auto blob = shouldStoreAsBlob ? storeBodyAsBlob(writeOperation, compressedBody) : std::nullopt;
 
-        auto channel = IOChannel::open(recordPath, IOChannel::Type::Create);
+        auto recordData = encodeRecord(writeOperation.record, compressedBody, blob);
         size_t recordSize = recordData.size();
-        channel->write(0, recordData, nullptr, [this, &writeOperation, recordSize](int error) {
+
+        if (shouldStoreRecordPacked(recordData)) {
+            // Don't leave behind an older version of the record stored in its own file.
+            WebCore::FileSystem::deleteFile(recordPath);
+            bool success = m_packedRecordStorage->add(writeOperation.record.key.hash(), recordData);
+
+            RunLoop::main().dispatch([this, &writeOperation, recordSize, success, recordExisted] {
+                if (!recordExisted)
+                    addToRecordFilter(writeOperation.record.key);
+                m_approximateRecordsSize += recordSize;
+                finishWriteOperation(writeOperation);
+
+                LOG(NetworkCacheStorage, "(NetworkProcess) packed write complete success=%d", success);
+            });
+            return;
+        }
+        if (m_packedRecordStorage)
+            m_packedRecordStorage->remove(writeOperation.record.key.hash());
+
+        auto channel = IOChannel::open(recordPath, IOChannel::Type::Create);
+        channel->write(0, recordData, nullptr, [this, &writeOperation, recordSize, recordExisted](int error) {
             // On error the entry still stays in the contents filter until next synchronization.
+            if (!recordExisted)
+                addToRecordFilter(writeOperation.record.key);
             m_approximateRecordsSize += recordSize;
             finishWriteOperation(writeOperation);
 
@@ -851,6 +1321,16 @@ void Storage::finishWriteOperation(WriteOperation& writeOperation)
     shrinkIfNeeded();
 }
 
+void Storage::touch(const Key& key)
+{
+    ASSERT(RunLoop::isMain());
+
+    if (!mayContain(key))
+        return;
+
+    updateRecordAccessTime(key);
+}
+
 void Storage::retrieve(const Key& key, unsigned priority, RetrieveCompletionHandler&& completionHandler)
 {
     ASSERT(RunLoop::isMain());
@@ -862,17 +1342,19 @@ void Storage::retrieve(const Key& key, unsigned priority, RetrieveCompletionHand
         return;
     }
 
-    if (!mayContain(key)) {
-        completionHandler(nullptr, { });
-        return;
-    }
-
     if (retrieveFromMemory(m_pendingWriteOperations, key, completionHandler))
         return;
     if (retrieveFromMemory(m_activeWriteOperations, key, completionHandler))
         return;
 
-    auto readOperation = std::make_unique<ReadOperation>(*this, key, WTFMove(completionHandler));
+    ++m_contentsFilterLookupCount;
+    if (!mayContain(key)) {
+        ++m_contentsFilterFilteredLookupCount;
+        completionHandler(nullptr, { });
+        return;
+    }
+
+    auto readOperation = std::make_unique<ReadOperation>(*this, key, priority, WTFMove(completionHandler));
 
     readOperation->timings.startTime = MonotonicTime::now();
     readOperation->timings.dispatchCountAtStart = m_readOperationDispatchCount;
@@ -892,8 +1374,8 @@ void Storage::store(const Record& record, MappedBodyHandler&& mappedBodyHandler,
     auto writeOperation = std::make_unique<WriteOperation>(*this, record, WTFMove(mappedBodyHandler), WTFMove(completionHandler));
     m_pendingWriteOperations.prepend(WTFMove(writeOperation));
 
-    // Add key to the filter already here as we do lookups from the pending operations too.
-    addToRecordFilter(record.key);
+    // The key gets added to the filter once the write knows whether the record is new. Lookups check the
+    // pending and active operations before the filter.
 
     bool isInitialWrite = m_pendingWriteOperations.size() == 1;
     if (!isInitialWrite)
@@ -902,6 +1384,34 @@ void Storage::store(const Record& record, MappedBodyHandler&& mappedBodyHandler,
     m_writeOperationDispatchTimer.startOneShot(m_initialWriteDelay);
 }
 
+void Storage::traverseRecord(TraverseOperation& traverseOperation, const Data& recordData, double worth, unsigned bodyShareCount)
+{
+    ASSERT(RunLoop::isMain());
+
+    RecordMetaData metaData;
+    Data headerData;
+    if (decodeRecordHeader(recordData, metaData, headerData, m_salt)) {
+        Record record {
+            metaData.key,
+            metaData.timeStamp,
+            headerData,
+            { },
+            metaData.bodyHash
+        };
+        RecordInfo info {
+            static_cast<size_t>(metaData.bodySize),
+            worth,
+            bodyShareCount,
+            String::fromUTF8(SHA1::hexDigest(metaData.bodyHash))
+        };
+        traverseOperation.handler(&record, info);
+    }
+
+    std::lock_guard<Lock> lock(traverseOperation.activeMutex);
+    --traverseOperation.activeCount;
+    traverseOperation.activeCondition.notifyOne();
+}
+
 void Storage::traverse(const String& type, TraverseFlags flags, TraverseHandler&& traverseHandler)
 {
     ASSERT(RunLoop::isMain());
@@ -932,35 +1442,40 @@ void Storage::traverse(const String& type, TraverseFlags flags, TraverseHandler&
 
             auto channel = IOChannel::open(recordPath, IOChannel::Type::Read);
             channel->read(0, std::numeric_limits<size_t>::max(), nullptr, [this, &traverseOperation, worth, bodyShareCount](Data& fileData, int) {
-                RecordMetaData metaData;
-                Data headerData;
-                if (decodeRecordHeader(fileData, metaData, headerData, m_salt)) {
-                    Record record {
-                        metaData.key,
-                        metaData.timeStamp,
-                        headerData,
-                        { },
-                        metaData.bodyHash
-                    };
-                    RecordInfo info {
-                        static_cast<size_t>(metaData.bodySize),
-                        worth,
-                        bodyShareCount,
-                        String::fromUTF8(SHA1::hexDigest(metaData.bodyHash))
-                    };
-                    traverseOperation.handler(&record, info);
-                }
-
-                std::lock_guard<Lock> lock(traverseOperation.activeMutex);
-                --traverseOperation.activeCount;
-                traverseOperation.activeCondition.notifyOne();
+                traverseRecord(traverseOperation, fileData, worth, bodyShareCount);
             });
 
-            static const unsigned maximumParallelReadCount = 5;
             traverseOperation.activeCondition.wait(lock, [&traverseOperation] {
-                return traverseOperation.activeCount <= maximumParallelReadCount;
+                return traverseOperation.activeCount <= maximumParallelTraverseReadCount;
             });
         });
+        if (m_packedRecordStorage) {
+            m_packedRecordStorage->traverse([this, &traverseOperation](const Key::HashType&, const Data& recordData, const FileTimes& times) {
+                RecordMetaData metaData;
+                if (!decodeRecordMetaData(metaData, recordData))
+                    return;
+                if (!traverseOperation.type.isEmpty() && metaData.key.type() != traverseOperation.type)
+                    return;
+
+                double worth = -1;
+                if (traverseOperation.flags & TraverseFlag::ComputeWorth)
+                    worth = computeRecordWorth(times);
+                unsigned bodyShareCount = 0;
+                if (traverseOperation.flags & TraverseFlag::ShareCount)
+                    bodyShareCount = m_blobStorage.shareCount(blobPathForKey(metaData.key));
+
+                std::unique_lock<Lock> lock(traverseOperation.activeMutex);
+                ++traverseOperation.activeCount;
+
+                RunLoop::main().dispatch([this, &traverseOperation, recordData, worth, bodyShareCount] {
+                    traverseRecord(traverseOperation, recordData, worth, bodyShareCount);
+                });
+
+                traverseOperation.activeCondition.wait(lock, [&traverseOperation] {
+                    return traverseOperation.activeCount <= maximumParallelTraverseReadCount;
+                });
+            });
+        }
         {
             // Wait for all reads to finish.
             std::unique_lock<Lock> lock(traverseOperation.activeMutex);
@@ -982,15 +1497,6 @@ void Storage::setCapacity(size_t capacity)
 {
     ASSERT(RunLoop::isMain());
 
-#if !ASSERT_DISABLED
-    const size_t assumedAverageRecordSize = 50 << 10;
-    size_t maximumRecordCount = capacity / assumedAverageRecordSize;
-    // ~10 bits per element are required for <1% false positive rate.
-    size_t effectiveBloomFilterCapacity = ContentsFilter::tableSize / 10;
-    // If this gets hit it might be time to increase the filter size.
-    ASSERT(maximumRecordCount < effectiveBloomFilterCapacity);
-#endif
-
     m_capacity = capacity;
 
     shrinkIfNeeded();
@@ -1006,6 +1512,7 @@ void Storage::clear(const String& type, WallTime modifiedSinceTime, Function<voi
     if (m_blobFilter)
         m_blobFilter->clear();
     m_approximateRecordsSize = 0;
+    scheduleContentsSnapshot();
 
     ioQueue().dispatch([this, protectedThis = makeRef(*this), modifiedSinceTime, completionHandler = WTFMove(completionHandler), type = type.isolatedCopy()] () mutable {
         auto recordsPath = this->recordsPath();
@@ -1019,6 +1526,22 @@ void Storage::clear(const String& type, WallTime modifiedSinceTime, Function<voi
             WebCore::FileSystem::deleteFile(filePath);
         });
 
+        if (m_packedRecordStorage) {
+            if (type.isEmpty() && modifiedSinceTime == -WallTime::infinity())
+                m_packedRecordStorage->clear();
+            else {
+                m_packedRecordStorage->traverse([&](const Key::HashType& hash, const Data& recordData, const FileTimes& times) {
+                    if (times.modification < modifiedSinceTime)
+                        return;
+                    RecordMetaData metaData;
+                    if (!type.isEmpty() && decodeRecordMetaData(metaData, recordData) && metaData.key.type() != type)
+                        return;
+                    m_packedRecordStorage->remove(hash);
+                });
+                m_packedRecordStorage->compactIfNeeded();
+            }
+        }
+
         deleteEmptyRecordsDirectories(recordsPath);
 
         // This cleans unreferenced blobs.
@@ -1045,23 +1568,24 @@ static double computeRecordWorth(FileTimes times)
     return accessAge / age;
 }
 
-static double deletionProbability(FileTimes times, unsigned bodyShareCount)
+static double evictionPriority(Storage::EvictionPolicy policy, FileTimes times, size_t size, unsigned bodyShareCount)
 {
-    static const double maximumProbability { 0.33 };
-    static const unsigned maximumEffectiveShareCount { 5 };
+    if (policy == Storage::EvictionPolicy::LeastRecentlyUsed)
+        return times.modification.secondsSinceEpoch().value();
 
-    auto worth = computeRecordWorth(times);
-
-    // Adjust a bit so the most valuable entries don't get deleted at all.
-    auto effectiveWorth = std::min(1.1 * worth, 1.);
+    static const double minimumWorth { 0.01 };
+    static const unsigned maximumEffectiveShareCount { 5 };
+    static const size_t minimumEffectiveSize { 4096 };
 
-    auto probability =  (1 - effectiveWorth) * maximumProbability;
+    // Greedy-Dual-Size style value per byte where the worth stands in for the access frequency.
+    // Small entries that have been accessed recently are the most valuable to keep.
+    double value = minimumWorth + computeRecordWorth(times);
 
     // It is less useful to remove an entry that shares its body data.
     if (bodyShareCount)
-        probability /= std::min(bodyShareCount, maximumEffectiveShareCount);
+        value *= std::min(bodyShareCount, maximumEffectiveShareCount);
 
-    return probability;
+    return value / std::max(size, minimumEffectiveSize);
 }
 
 void Storage::shrinkIfNeeded()
@@ -1080,43 +1604,135 @@ void Storage::shrink()
 {
     ASSERT(RunLoop::isMain());
 
-    if (m_shrinkInProgress || m_synchronizationInProgress)
+    // Packed records are only found through their index, so wait until it is loaded. shrinkIfNeeded() runs again then.
+    if (m_shrinkInProgress || m_synchronizationInProgress || m_packedRecordIndexLoadInProgress)
         return;
     m_shrinkInProgress = true;
 
     LOG(NetworkCacheStorage, "(NetworkProcess) shrinking cache approximateSize=%zu capacity=%zu", approximateSize(), m_capacity);
 
-    backgroundIOQueue().dispatch([this, protectedThis = makeRef(*this)] () mutable {
+    // Leave some room so that the next few stores don't immediately trigger another shrink.
+    const double shrinkTargetRatio = 0.8;
+    evictToSize(static_cast<size_t>(m_capacity * shrinkTargetRatio));
+}
+
+struct EvictionCandidate {
+    Key::HashType hash;
+    // Null for packed records.
+    String recordPath;
+    String blobPath;
+    size_t recordSize;
+    // The blob only gets freed when its last record goes away.
+    size_t freedBlobSize;
+    double priority;
+};
+
+void Storage::evictToSize(size_t targetSize)
+{
+    ASSERT(RunLoop::isMain());
+    ASSERT(m_shrinkInProgress);
+
+    size_t recordsSizeAtStart = m_approximateRecordsSize;
+
+    backgroundIOQueue().dispatch([this, protectedThis = makeRef(*this), targetSize, recordsSizeAtStart, policy = m_evictionPolicy] () mutable {
+        Vector<EvictionCandidate> candidates;
+        size_t recordsSize = 0;
+
         auto recordsPath = this->recordsPath();
         String anyType;
-        traverseRecordsFiles(recordsPath, anyType, [this](const String& fileName, const String& hashString, const String& type, bool isBlob, const String& recordDirectoryPath) {
+        traverseRecordsFiles(recordsPath, anyType, [&](const String& fileName, const String& hashString, const String& type, bool isBlob, const String& recordDirectoryPath) {
             if (isBlob)
                 return;
 
-            auto recordPath = WebCore::FileSystem::pathByAppendingComponent(recordDirectoryPath, fileName);
-            auto blobPath = blobPathForRecordPath(recordPath);
+            EvictionCandidate candidate;
+            if (!Key::stringToHash(hashString, candidate.hash))
+                return;
+            candidate.recordPath = WebCore::FileSystem::pathByAppendingComponent(recordDirectoryPath, fileName);
+            candidate.blobPath = blobPathForRecordPath(candidate.recordPath);
 
-            auto times = fileTimes(recordPath);
-            unsigned bodyShareCount = m_blobStorage.shareCount(blobPath);
-            auto probability = deletionProbability(times, bodyShareCount);
+            // One query for the record and one for its blob.
+            long long fileSize = 0;
+            auto times = fileTimesAndSize(candidate.recordPath, fileSize);
+            candidate.recordSize = fileSize;
 
-            bool shouldDelete = randomNumber() < probability;
+            auto blobInfo = m_blobStorage.linkInfo(candidate.blobPath);
+            candidate.freedBlobSize = blobInfo.shareCount == 1 ? blobInfo.size : 0;
+            candidate.priority = evictionPriority(policy, times, candidate.recordSize + blobInfo.size, blobInfo.shareCount);
 
-            LOG(NetworkCacheStorage, "Deletion probability=%f bodyLinkCount=%d shouldDelete=%d", probability, bodyShareCount, shouldDelete);
+            recordsSize += candidate.recordSize;
+            candidates.append(WTFMove(candidate));
+        });
 
-            if (shouldDelete) {
-                WebCore::FileSystem::deleteFile(recordPath);
-                m_blobStorage.remove(blobPath);
-            }
+        if (m_packedRecordStorage) {
+            // Packed record times come from the pack index so there is no need to stat anything but the blob.
+            m_packedRecordStorage->traverse([&](const Key::HashType& hash, const Data& recordData, const FileTimes& times) {
+                EvictionCandidate candidate;
+                candidate.hash = hash;
+                candidate.recordSize = recordData.size();
+
+                RecordMetaData metaData;
+                if (decodeRecordMetaData(metaData, recordData))
+                    candidate.blobPath = blobPathForKey(metaData.key);
+
+                auto blobInfo = candidate.blobPath.isNull() ? BlobStorage::LinkInfo { } : m_blobStorage.linkInfo(candidate.blobPath);
+                candidate.freedBlobSize = blobInfo.shareCount == 1 ? blobInfo.size : 0;
+                // Undecodable records go first.
+                candidate.priority = candidate.blobPath.isNull() ? 0 : evictionPriority(policy, times, candidate.recordSize + blobInfo.size, blobInfo.shareCount);
+
+                recordsSize += candidate.recordSize;
+                candidates.append(WTFMove(candidate));
+            });
+        }
+
+        // Ties are broken by hash so the result only depends on the cache contents.
+        std::sort(candidates.begin(), candidates.end(), [](auto& a, auto& b) {
+            if (a.priority != b.priority)
+                return a.priority < b.priority;
+            return a.hash < b.hash;
         });
 
-        RunLoop::main().dispatch([this, protectedThis = WTFMove(protectedThis)] {
+        // The blob size may still include bodies that lost their records, which only makes the eviction a bit more eager.
+        size_t blobsSize = m_blobStorage.approximateSize();
+        Vector<std::pair<Key::HashType, DeletedFiles>> deletedFilesForHashes;
+        for (auto& candidate : candidates) {
+            if (recordsSize + blobsSize <= targetSize)
+                break;
+
+            DeletedFiles deletedFiles;
+            if (candidate.recordPath.isNull())
+                deletedFiles.record = m_packedRecordStorage->remove(candidate.hash);
+            else
+                deletedFiles.record = WebCore::FileSystem::deleteFile(candidate.recordPath);
+            if (!candidate.blobPath.isNull())
+                deletedFiles.blob = m_blobStorage.remove(candidate.blobPath);
+
+            recordsSize -= candidate.recordSize;
+            if (deletedFiles.blob)
+                blobsSize -= std::min(blobsSize, candidate.freedBlobSize);
+            deletedFilesForHashes.append({ candidate.hash, deletedFiles });
+        }
+
+        if (m_packedRecordStorage)
+            m_packedRecordStorage->compactIfNeeded();
+
+        // Unlink the bodies that no longer have records.
+        m_blobStorage.synchronize();
+
+        deleteEmptyRecordsDirectories(recordsPath);
+
+        LOG(NetworkCacheStorage, "(NetworkProcess) cache eviction completed evictedCount=%zu recordsSize=%zu blobsSize=%zu", deletedFilesForHashes.size(), recordsSize, m_blobStorage.approximateSize());
+
+        RunLoop::main().dispatch([this, protectedThis = WTFMove(protectedThis), deletedFilesForHashes = WTFMove(deletedFilesForHashes), recordsSize, recordsSizeAtStart] {
+            didRemoveRecords(deletedFilesForHashes);
+
+            // Keep the records stored while the eviction was running.
+            size_t recordsSizeAddedDuringEviction = m_approximateRecordsSize > recordsSizeAtStart ? m_approximateRecordsSize - recordsSizeAtStart : 0;
+            m_approximateRecordsSize = recordsSize + recordsSizeAddedDuringEviction;
             m_shrinkInProgress = false;
-            // We could synchronize during the shrink traversal. However this is fast and it is better to have just one code path.
-            synchronize();
-        });
 
-        LOG(NetworkCacheStorage, "(NetworkProcess) cache shrink completed");
+            // The contents filters are kept exact by the removals above so there is no need to synchronize.
+            scheduleContentsSnapshot();
+        });
     });
 }
 
@@ -26,15 +26,16 @@
 #pragma once
 
 #include "NetworkCacheBlobStorage.h"
+#include "NetworkCacheContentsFilter.h"
 #include "NetworkCacheData.h"
 #include "NetworkCacheKey.h"
 #include <WebCore/Timer.h>
-#include <wtf/BloomFilter.h>
 #include <wtf/CompletionHandler.h>
 #include <wtf/Deque.h>
 #include <wtf/Function.h>
 #include <wtf/HashSet.h>
 #include <wtf/MonotonicTime.h>
+#include <wtf/OptionSet.h>
 #include <wtf/Optional.h>
 #include <wtf/WallTime.h>
 #include <wtf/WorkQueue.h>
@@ -44,11 +45,16 @@ namespace WebKit {
 namespace NetworkCache {
 
 class IOChannel;
+class PackedRecordStorage;
 
 class Storage : public ThreadSafeRefCounted<Storage> {
 public:
     enum class Mode { Normal, Testing };
-    static RefPtr<Storage> open(const String& cachePath, Mode);
+    enum class Option {
+        // Small records are appended to a single pack file instead of getting a file each.
+        PackedRecords = 1 << 0,
+    };
+    static RefPtr<Storage> open(const String& cachePath, Mode, OptionSet<Option> = { });
 
     struct Record {
         Key key;
@@ -56,6 +62,8 @@ public:
         Data header;
         Data body;
         std::optional<SHA1::Digest> bodyHash;
+        // Hint that the body is likely to compress well. Storage decides whether it is worth it.
+        bool shouldCompressBody { false };
 
         WTF_MAKE_FAST_ALLOCATED;
     };
@@ -80,6 +88,8 @@ public:
     // This may call completion handler synchronously on failure.
     using RetrieveCompletionHandler = Function<bool (std::unique_ptr<Record>, const Timings&)>;
     void retrieve(const Key&, unsigned priority, RetrieveCompletionHandler&&);
+    // Records a use of an entry that was served without reading it from storage.
+    void touch(const Key&);
 
     using MappedBodyHandler = Function<void (const Data& mappedBody)>;
     void store(const Record&, MappedBodyHandler&&, CompletionHandler<void()>&& = { });
@@ -88,6 +98,10 @@ public:
     void remove(const Vector<Key>&, Function<void ()>&&);
     void clear(const String& type, WallTime modifiedSinceTime, Function<void ()>&& completionHandler);
 
+    // Called on the main thread with the hashes of the records that got removed, including the ones evicted when shrinking.
+    using RecordsRemovedHandler = Function<void (const Vector<Key::HashType>&)>;
+    void setRecordsRemovedHandler(RecordsRemovedHandler&& handler) { m_recordsRemovedHandler = WTFMove(handler); }
+
     struct RecordInfo {
         size_t bodySize;
         double worth; // 0-1 where 1 is the most valuable.
@@ -103,12 +117,37 @@ public:
     // Null record signals end.
     void traverse(const String& type, TraverseFlags, TraverseHandler&&);
 
+    struct ContentsFilterStatistics {
+        uint64_t lookupCount { 0 };
+        uint64_t filteredLookupCount { 0 };
+        // Lookups that passed the filter but found no record.
+        uint64_t falsePositiveCount { 0 };
+        size_t recordCount { 0 };
+        size_t capacity { 0 };
+        double expectedFalsePositiveRate { 0 };
+    };
+    ContentsFilterStatistics contentsFilterStatistics() const;
+
+    enum class SnapshotType { Checkpoint, Final };
+    // Persists the contents filters and the size so that the next launch doesn't need to traverse all records.
+    // A final snapshot is only trusted as is if nothing gets stored after it.
+    void writeContentsSnapshot(SnapshotType, Function<void ()>&& completionHandler);
+
+    // The order in which records are evicted when the cache is over capacity.
+    enum class EvictionPolicy {
+        // The records with the lowest worth per byte go first.
+        CostAware,
+        // The records that were accessed the longest time ago go first, whatever their size.
+        LeastRecentlyUsed,
+    };
+    void setEvictionPolicy(EvictionPolicy policy) { m_evictionPolicy = policy; }
+
     void setCapacity(size_t);
     size_t capacity() const { return m_capacity; }
     size_t approximateSize() const;
 
     // Incrementing this number will delete all existing cache content for everyone. Do you really need to do it?
-    static const unsigned version = 13;
+    static const unsigned version = 15;
 #if PLATFORM(MAC)
     /// Allow the last stable version of the cache to co-exist with the latest development one.
     static const unsigned lastStableVersion = 13;
@@ -125,16 +164,20 @@ public:
     void writeWithoutWaiting() { m_initialWriteDelay = 0_s; };
 
 private:
-    Storage(const String& directoryPath, Mode, Salt);
+    Storage(const String& directoryPath, Mode, OptionSet<Option>, Salt);
 
     String recordDirectoryPathForKey(const Key&) const;
     String recordPathForKey(const Key&) const;
     String blobPathForKey(const Key&) const;
 
     void synchronize();
+    bool restoreContentsSnapshot();
+    void scheduleContentsSnapshot();
+    void contentsSnapshotTimerFired();
     void deleteOldVersions();
     void shrinkIfNeeded();
     void shrink();
+    void evictToSize(size_t targetSize);
 
     struct ReadOperation;
     void dispatchReadOperation(std::unique_ptr<ReadOperation>);
@@ -147,12 +190,16 @@ private:
     void dispatchPendingWriteOperations();
     void finishWriteOperation(WriteOperation&);
 
+    struct TraverseOperation;
+    void traverseRecord(TraverseOperation&, const Data& recordData, double worth, unsigned bodyShareCount);
+
     bool shouldStoreBodyAsBlob(const Data& bodyData);
-    std::optional<BlobStorage::Blob> storeBodyAsBlob(WriteOperation&);
-    Data encodeRecord(const Record&, std::optional<BlobStorage::Blob>);
+    bool shouldStoreRecordPacked(const Data& recordData);
+    std::optional<BlobStorage::Blob> storeBodyAsBlob(WriteOperation&, const Data& compressedBody);
+    Data encodeRecord(const Record&, const Data& compressedBody, std::optional<BlobStorage::Blob>);
     void readRecord(ReadOperation&, const Data&);
 
-    void updateFileModificationTime(const String& path);
+    void updateRecordAccessTime(const Key&);
     void removeFromPendingWriteOperations(const Key&);
 
     WorkQueue& ioQueue() { return m_ioQueue.get(); }
@@ -163,7 +210,15 @@ private:
     bool mayContainBlob(const Key&) const;
 
     void addToRecordFilter(const Key&);
-    void deleteFiles(const Key&);
+    void addToBlobFilter(const Key&);
+    void removeFromContentsFilters(const Key::HashType&, bool removeRecord, bool removeBlob);
+    bool hasWriteOperation(const Key::HashType&) const;
+    struct DeletedFiles {
+        bool record { false };
+        bool blob { false };
+    };
+    DeletedFiles deleteFiles(const Key&);
+    void didRemoveRecords(const Vector<std::pair<Key::HashType, DeletedFiles>>&);
 
     const String m_basePath;
     const String m_recordsPath;
@@ -173,19 +228,28 @@ private:
     const bool m_canUseBlobsForForBodyData;
 
     size_t m_capacity { std::numeric_limits<size_t>::max() };
+    EvictionPolicy m_evictionPolicy { EvictionPolicy::CostAware };
     size_t m_approximateRecordsSize { 0 };
 
-    // 2^18 bit filter can support up to 26000 entries with false positive rate < 1%.
-    using ContentsFilter = BloomFilter<18>;
     std::unique_ptr<ContentsFilter> m_recordFilter;
     std::unique_ptr<ContentsFilter> m_blobFilter;
 
+    RecordsRemovedHandler m_recordsRemovedHandler;
+
     bool m_synchronizationInProgress { false };
     bool m_shrinkInProgress { false };
+    // Reads and writes are held while the packed record index loads after a snapshot restore, see restoreContentsSnapshot().
+    bool m_packedRecordIndexLoadInProgress { false };
     size_t m_readOperationDispatchCount { 0 };
 
     Vector<Key::HashType> m_recordFilterHashesAddedDuringSynchronization;
     Vector<Key::HashType> m_blobFilterHashesAddedDuringSynchronization;
+    // Used for sizing the filters on the next synchronization.
+    size_t m_recordCountHint { 0 };
+    size_t m_blobCountHint { 0 };
+    uint64_t m_contentsFilterLookupCount { 0 };
+    uint64_t m_contentsFilterFilteredLookupCount { 0 };
+    uint64_t m_contentsFilterFalsePositiveCount { 0 };
 
     static const int maximumRetrievePriority = 4;
     Deque<std::unique_ptr<ReadOperation>> m_pendingReadOperationsByPriority[maximumRetrievePriority + 1];
@@ -196,7 +260,9 @@ private:
     HashSet<std::unique_ptr<WriteOperation>> m_activeWriteOperations;
     WebCore::Timer m_writeOperationDispatchTimer;
 
-    struct TraverseOperation;
+    WebCore::Timer m_contentsSnapshotTimer;
+    bool m_hasFinalContentsSnapshot { false };
+
     HashSet<std::unique_ptr<TraverseOperation>> m_activeTraverseOperations;
 
     Ref<WorkQueue> m_ioQueue;
@@ -204,6 +270,7 @@ private:
     Ref<WorkQueue> m_serialBackgroundIOQueue;
 
     BlobStorage m_blobStorage;
+    std::unique_ptr<PackedRecordStorage> m_packedRecordStorage;
 
     // By default, delay the start of writes a bit to avoid affecting early page load.
     // Completing writes will dispatch more writes without delay.
@@ -34,12 +34,20 @@
 namespace WebKit {
 namespace NetworkCache {
 
+// Usage counts only cover the recent loads so that confidence follows changes to the page.
+static const unsigned maximumLoadCount = 16;
+// Subresources that were not used recently are dropped once their confidence falls below this.
+static const double minimumConfidenceToKeep = 0.2;
+
 void SubresourceInfo::encode(WTF::Persistence::Encoder& encoder) const
 {
     encoder << m_key;
     encoder << m_lastSeen;
     encoder << m_firstSeen;
     encoder << m_isTransient;
+    encoder << m_useCount;
+    encoder << m_loadCount;
+    encoder << m_position;
 
     // Do not bother serializing other data members of transient resources as they are empty.
     if (m_isTransient)
@@ -62,7 +70,16 @@ bool SubresourceInfo::decode(WTF::Persistence::Decoder& decoder, SubresourceInfo
     
     if (!decoder.decode(info.m_isTransient))
         return false;
-    
+
+    if (!decoder.decode(info.m_useCount))
+        return false;
+    if (!decoder.decode(info.m_loadCount))
+        return false;
+    if (!info.m_loadCount || info.m_useCount > info.m_loadCount)
+        return false;
+    if (!decoder.decode(info.m_position))
+        return false;
+
     if (info.m_isTransient)
         return true;
 
@@ -114,16 +131,34 @@ SubresourcesEntry::SubresourcesEntry(const Storage::Record& storageEntry)
     ASSERT(m_key.type() == "SubResources");
 }
 
-SubresourceInfo::SubresourceInfo(const Key& key, const WebCore::ResourceRequest& request, const SubresourceInfo* previousInfo)
+static void limitLoadCount(unsigned& useCount, unsigned& loadCount)
+{
+    if (loadCount <= maximumLoadCount)
+        return;
+    useCount = (useCount + 1) / 2;
+    loadCount = (loadCount + 1) / 2;
+}
+
+SubresourceInfo::SubresourceInfo(const Key& key, const WebCore::ResourceRequest& request, const SubresourceInfo* previousInfo, unsigned position)
     : m_key(key)
     , m_lastSeen(WallTime::now())
     , m_firstSeen(previousInfo ? previousInfo->firstSeen() : m_lastSeen)
     , m_isTransient(!previousInfo)
+    , m_useCount(previousInfo ? previousInfo->m_useCount + 1 : 1)
+    , m_loadCount(previousInfo ? previousInfo->m_loadCount + 1 : 1)
+    , m_position(position)
     , m_isSameSite(request.isSameSite())
     , m_firstPartyForCookies(request.firstPartyForCookies())
     , m_requestHeaders(request.httpHeaderFields())
     , m_priority(request.priority())
 {
+    limitLoadCount(m_useCount, m_loadCount);
+}
+
+void SubresourceInfo::didNotUse()
+{
+    ++m_loadCount;
+    limitLoadCount(m_useCount, m_loadCount);
 }
 
 static Vector<SubresourceInfo> makeSubresourceInfoVector(const Vector<std::unique_ptr<SubresourceLoad>>& subresourceLoads, Vector<SubresourceInfo>* previousSubresources)
@@ -149,13 +184,26 @@ static Vector<SubresourceInfo> makeSubresourceInfoVector(const Vector<std::uniqu
                 previousInfo = &(*previousSubresources)[it->value];
         }
         
-        result.uncheckedAppend({ load->key, load->request, previousInfo });
+        result.uncheckedAppend({ load->key, load->request, previousInfo, static_cast<unsigned>(result.size()) });
         
         // FIXME: We should really consider all resources seen for the first time transient.
         if (!previousSubresources)
             result.last().setNonTransient();
     }
 
+    if (!previousSubresources)
+        return result;
+
+    // Remember subresources that were not used this time while they are still used often enough.
+    for (auto& previousInfo : *previousSubresources) {
+        if (deduplicationSet.contains(previousInfo.key()))
+            continue;
+        SubresourceInfo info = previousInfo;
+        info.didNotUse();
+        if (info.confidence() >= minimumConfidenceToKeep)
+            result.append(WTFMove(info));
+    }
+
     return result;
 }
 
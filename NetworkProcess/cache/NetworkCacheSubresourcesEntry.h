@@ -43,12 +43,19 @@ public:
     static bool decode(WTF::Persistence::Decoder&, SubresourceInfo&);
 
     SubresourceInfo() = default;
-    SubresourceInfo(const Key&, const WebCore::ResourceRequest&, const SubresourceInfo* previousInfo);
+    SubresourceInfo(const Key&, const WebCore::ResourceRequest&, const SubresourceInfo* previousInfo, unsigned position);
 
     const Key& key() const { return m_key; }
     WallTime lastSeen() const { return m_lastSeen; }
     WallTime firstSeen() const { return m_firstSeen; }
 
+    // Fraction of the recent loads of the main resource that used this subresource. It means little until the
+    // main resource was loaded a few times, so until then subresources are treated as if they were always used.
+    double confidence() const { return m_loadCount < minimumLoadCountForConfidence ? 1 : static_cast<double>(m_useCount) / m_loadCount; }
+    // Index of this subresource in the order it was requested the last time it was used.
+    unsigned position() const { return m_position; }
+    void didNotUse();
+
     bool isTransient() const { return m_isTransient; }
     const WebCore::URL& firstPartyForCookies() const { ASSERT(!m_isTransient); return m_firstPartyForCookies; }
     const WebCore::HTTPHeaderMap& requestHeaders() const { ASSERT(!m_isTransient); return m_requestHeaders; }
@@ -60,10 +67,15 @@ public:
     void setNonTransient() { m_isTransient = false; }
 
 private:
+    static const unsigned minimumLoadCountForConfidence = 3;
+
     Key m_key;
     WallTime m_lastSeen;
     WallTime m_firstSeen;
     bool m_isTransient { false };
+    unsigned m_useCount { 1 };
+    unsigned m_loadCount { 1 };
+    unsigned m_position { 0 };
     bool m_isSameSite { false };
     WebCore::URL m_firstPartyForCookies;
     WebCore::HTTPHeaderMap m_requestHeaders;
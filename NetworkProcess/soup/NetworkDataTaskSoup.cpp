@@ -42,14 +42,27 @@
 #include <wtf/MainThread.h>
 #include <wtf/glib/RunLoopSourcePriority.h>
 
+#if OS(LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace WebKit {
 using namespace WebCore;
 
 static const size_t gDefaultReadBufferSize = 8192;
+static const size_t gMediaReadBufferSize = 32 * 1024;
+static const size_t gMaximumReadBufferSize = 64 * 1024;
+static const size_t gMaximumDownloadReadBufferSize = 256 * 1024;
+// Small chunks are merged up to this size before being handed to the client.
+static const size_t gCoalescedDataSize = 64 * 1024;
+// Chunks that can wait for the disk while we keep reading from the network.
+static const size_t gMaximumPendingDownloadBuffers = 4;
 
 NetworkDataTaskSoup::NetworkDataTaskSoup(NetworkSession& session, NetworkDataTaskClient& client, const ResourceRequest& requestWithCredentials, StoredCredentialsPolicy storedCredentialsPolicy, ContentSniffingPolicy shouldContentSniff, WebCore::ContentEncodingSniffingPolicy, bool shouldClearReferrerOnHTTPSToHTTPRedirect, bool dataTaskIsForMainFrameNavigation)
     : NetworkDataTask(session, client, requestWithCredentials, storedCredentialsPolicy, shouldClearReferrerOnHTTPSToHTTPRedirect, dataTaskIsForMainFrameNavigation)
     , m_shouldContentSniff(shouldContentSniff)
+    , m_readBufferSize(requestWithCredentials.requester() == ResourceRequest::Requester::Media ? gMediaReadBufferSize : gDefaultReadBufferSize)
     , m_timeoutSource(RunLoop::main(), this, &NetworkDataTaskSoup::timeoutFired)
 {
     m_session->registerNetworkDataTask(*this);
@@ -730,22 +743,72 @@ void NetworkDataTaskSoup::read()
 {
     RefPtr<NetworkDataTaskSoup> protectedThis(this);
     ASSERT(m_inputStream);
-    m_readBuffer.grow(gDefaultReadBufferSize);
+    m_readBuffer.resize(m_readBufferSize);
     g_input_stream_read_async(m_inputStream.get(), m_readBuffer.data(), m_readBuffer.size(), RunLoopSourcePriority::AsyncIONetwork, m_cancellable.get(),
         reinterpret_cast<GAsyncReadyCallback>(readCallback), protectedThis.leakRef());
 }
 
 void NetworkDataTaskSoup::didRead(gssize bytesRead)
 {
+    // A full buffer means more data was already available, so read bigger chunks.
+    // Mostly empty reads mean a slow link, so give back some of the buffer.
+    bool didFillBuffer = static_cast<size_t>(bytesRead) == m_readBuffer.size();
+    if (didFillBuffer)
+        m_readBufferSize = std::min(m_readBufferSize * 2, m_downloadOutputStream ? gMaximumDownloadReadBufferSize : gMaximumReadBufferSize);
+    else if (static_cast<size_t>(bytesRead) < m_readBufferSize / 4)
+        m_readBufferSize = std::max(m_readBufferSize / 2, gDefaultReadBufferSize);
+
     m_readBuffer.shrink(bytesRead);
     if (m_downloadOutputStream) {
         ASSERT(isDownload());
-        writeDownload();
-    } else {
+        m_downloadBuffers.append(WTFMove(m_readBuffer));
+        if (m_downloadBuffers.size() == 1)
+            writeDownload();
+
+        // Keep the network busy while the disk write is in progress.
+        if (m_downloadBuffers.size() < gMaximumPendingDownloadBuffers)
+            read();
+        else
+            m_isDownloadReadPaused = true;
+        return;
+    }
+
+    // Only keep data back while the stream can give us more right away.
+    bool shouldCoalesce = didFillBuffer && isInputStreamReadable();
+    if (m_pendingData.isEmpty() && (!shouldCoalesce || m_readBuffer.size() >= gCoalescedDataSize)) {
         ASSERT(m_client);
-        m_client->didReceiveData(SharedBuffer::create(WTFMove(m_readBuffer)));
-        read();
+        // Nothing to merge with, or already as large as a merged chunk. Hand the read buffer over unless most of
+        // its capacity would be wasted, which happens with short reads into a grown buffer; copy the bytes then.
+        if (m_readBuffer.capacity() <= 2 * m_readBuffer.size())
+            m_client->didReceiveData(SharedBuffer::create(WTFMove(m_readBuffer)));
+        else
+            m_client->didReceiveData(SharedBuffer::create(m_readBuffer.data(), m_readBuffer.size()));
+    } else {
+        m_pendingData.reserveCapacity(gCoalescedDataSize);
+        m_pendingData.append(m_readBuffer.data(), m_readBuffer.size());
+        if (!shouldCoalesce || m_pendingData.size() >= gCoalescedDataSize)
+            flushPendingData();
     }
+    read();
+}
+
+bool NetworkDataTaskSoup::isInputStreamReadable() const
+{
+    // When we can't tell, don't hold data back waiting for a read that may block.
+    if (!G_IS_POLLABLE_INPUT_STREAM(m_inputStream.get()))
+        return false;
+
+    auto* pollableInputStream = G_POLLABLE_INPUT_STREAM(m_inputStream.get());
+    return g_pollable_input_stream_can_poll(pollableInputStream) && g_pollable_input_stream_is_readable(pollableInputStream);
+}
+
+void NetworkDataTaskSoup::flushPendingData()
+{
+    if (m_pendingData.isEmpty())
+        return;
+
+    ASSERT(m_client);
+    m_client->didReceiveData(SharedBuffer::create(WTFMove(m_pendingData)));
 }
 
 void NetworkDataTaskSoup::didFinishRead()
@@ -753,13 +816,25 @@ void NetworkDataTaskSoup::didFinishRead()
     ASSERT(m_inputStream);
     g_input_stream_close(m_inputStream.get(), nullptr, nullptr);
     m_inputStream = nullptr;
+    if (!m_pendingData.isEmpty()) {
+        flushPendingData();
+        if (m_state == State::Canceling || m_state == State::Completed || !m_client) {
+            clearRequest();
+            return;
+        }
+    }
+
     if (m_multipartInputStream) {
         requestNextPart();
         return;
     }
 
     if (m_downloadOutputStream) {
-        didFinishDownload();
+        // Wait for the chunks still being written.
+        if (m_downloadBuffers.isEmpty())
+            didFinishDownload();
+        else
+            m_didFinishDownloadRead = true;
         return;
     }
 
@@ -914,10 +989,35 @@ void NetworkDataTaskSoup::download()
     downloadManager.dataTaskBecameDownloadTask(m_pendingDownloadID, WTFMove(download));
     downloadPtr->didCreateDestination(m_pendingDownloadLocation);
 
+    preallocateDownloadFile();
+
     ASSERT(!m_client);
     read();
 }
 
+void NetworkDataTaskSoup::preallocateDownloadFile()
+{
+#if OS(LINUX)
+    // The expected length is the one of the encoded body, which tells nothing about the size of the file.
+    long long expectedContentLength = m_response.expectedContentLength();
+    if (expectedContentLength <= 0 || !m_response.httpHeaderField(HTTPHeaderName::ContentEncoding).isEmpty())
+        return;
+
+    GUniquePtr<char> path(g_file_get_path(m_downloadIntermediateFile.get()));
+    if (!path)
+        return;
+
+    int fileDescriptor = open(path.get(), O_WRONLY | O_CLOEXEC);
+    if (fileDescriptor == -1)
+        return;
+
+    // Reserve the blocks up front so large downloads aren't fragmented. The file size is still
+    // set by the writes, in case the server sends fewer bytes than announced.
+    fallocate(fileDescriptor, FALLOC_FL_KEEP_SIZE, 0, expectedContentLength);
+    close(fileDescriptor);
+#endif
+}
+
 void NetworkDataTaskSoup::writeDownloadCallback(GOutputStream* outputStream, GAsyncResult* result, NetworkDataTaskSoup* task)
 {
     RefPtr<NetworkDataTaskSoup> protectedThis = adoptRef(task);
@@ -945,18 +1045,22 @@ void NetworkDataTaskSoup::writeDownloadCallback(GOutputStream* outputStream, GAs
 void NetworkDataTaskSoup::writeDownload()
 {
     RefPtr<NetworkDataTaskSoup> protectedThis(this);
+    ASSERT(!m_downloadBuffers.isEmpty());
+    auto& buffer = m_downloadBuffers.first();
 #if GLIB_CHECK_VERSION(2, 44, 0)
-    g_output_stream_write_all_async(m_downloadOutputStream.get(), m_readBuffer.data(), m_readBuffer.size(), RunLoopSourcePriority::AsyncIONetwork, m_cancellable.get(),
+    g_output_stream_write_all_async(m_downloadOutputStream.get(), buffer.data(), buffer.size(), RunLoopSourcePriority::AsyncIONetwork, m_cancellable.get(),
         reinterpret_cast<GAsyncReadyCallback>(writeDownloadCallback), protectedThis.leakRef());
 #else
     GRefPtr<GTask> writeTask = adoptGRef(g_task_new(m_downloadOutputStream.get(), m_cancellable.get(),
         reinterpret_cast<GAsyncReadyCallback>(writeDownloadCallback), protectedThis.leakRef()));
-    g_task_set_task_data(writeTask.get(), this, nullptr);
+    // The buffer outlives the write, but more chunks can be queued meanwhile, so the thread must not touch the queue.
+    using BufferSpan = std::pair<const char*, size_t>;
+    g_task_set_task_data(writeTask.get(), new BufferSpan(buffer.data(), buffer.size()), [](gpointer data) {
+        delete static_cast<BufferSpan*>(data);
+    });
     g_task_run_in_thread(writeTask.get(), [](GTask* writeTask, gpointer source, gpointer userData, GCancellable* cancellable) {
-        auto* task = static_cast<NetworkDataTaskSoup*>(userData);
+        auto* buffer = static_cast<BufferSpan*>(userData);
         GOutputStream* outputStream = G_OUTPUT_STREAM(source);
-        RELEASE_ASSERT(task->m_downloadOutputStream.get() == outputStream);
-        RELEASE_ASSERT(task->m_cancellable.get() == cancellable);
         GError* error = nullptr;
         if (g_cancellable_set_error_if_cancelled(cancellable, &error)) {
             g_task_return_error(writeTask, error);
@@ -964,7 +1068,7 @@ void NetworkDataTaskSoup::writeDownload()
         }
 
         gsize bytesWritten;
-        if (g_output_stream_write_all(outputStream, task->m_readBuffer.data(), task->m_readBuffer.size(), &bytesWritten, cancellable, &error))
+        if (g_output_stream_write_all(outputStream, buffer->first, buffer->second, &bytesWritten, cancellable, &error))
             g_task_return_int(writeTask, bytesWritten);
         else
             g_task_return_error(writeTask, error);
@@ -974,11 +1078,25 @@ void NetworkDataTaskSoup::writeDownload()
 
 void NetworkDataTaskSoup::didWriteDownload(gsize bytesWritten)
 {
-    ASSERT(bytesWritten == m_readBuffer.size());
+    ASSERT(!m_downloadBuffers.isEmpty());
+    ASSERT(bytesWritten == m_downloadBuffers.first().size());
+    static_cast<NetworkSessionSoup&>(m_session.get()).recycleReadBuffer(m_downloadBuffers.takeFirst());
+
     auto* download = NetworkProcess::singleton().downloadManager().download(m_pendingDownloadID);
     ASSERT(download);
     download->didReceiveData(bytesWritten);
-    read();
+
+    if (!m_downloadBuffers.isEmpty())
+        writeDownload();
+    else if (m_didFinishDownloadRead) {
+        didFinishDownload();
+        return;
+    }
+
+    if (m_isDownloadReadPaused) {
+        m_isDownloadReadPaused = false;
+        read();
+    }
 }
 
 void NetworkDataTaskSoup::didFinishDownload()
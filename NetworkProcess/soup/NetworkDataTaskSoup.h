@@ -29,6 +29,7 @@
 #include <WebCore/NetworkLoadMetrics.h>
 #include <WebCore/ProtectionSpace.h>
 #include <WebCore/ResourceResponse.h>
+#include <wtf/Deque.h>
 #include <wtf/RunLoop.h>
 #include <wtf/glib/GRefPtr.h>
 
@@ -83,6 +84,8 @@ private:
     static void readCallback(GInputStream*, GAsyncResult*, NetworkDataTaskSoup*);
     void read();
     void didRead(gssize bytesRead);
+    bool isInputStreamReadable() const;
+    void flushPendingData();
     void didFinishRead();
 
     static void requestNextPartCallback(SoupMultipartInputStream*, GAsyncResult*, NetworkDataTaskSoup*);
@@ -100,6 +103,7 @@ private:
     static void writeDownloadCallback(GOutputStream*, GAsyncResult*, NetworkDataTaskSoup*);
     void writeDownload();
     void didWriteDownload(gsize bytesWritten);
+    void preallocateDownloadFile();
     void didFailDownload(const WebCore::ResourceError&);
     void didFinishDownload();
     void cleanDownloadFiles();
@@ -130,11 +134,17 @@ private:
     WebCore::ResourceRequest m_currentRequest;
     WebCore::ResourceResponse m_response;
     Vector<char> m_readBuffer;
+    size_t m_readBufferSize;
+    Vector<char> m_pendingData;
     unsigned m_redirectCount { 0 };
     uint64_t m_bodyDataTotalBytesSent { 0 };
     GRefPtr<GFile> m_downloadDestinationFile;
     GRefPtr<GFile> m_downloadIntermediateFile;
     GRefPtr<GOutputStream> m_downloadOutputStream;
+    // Chunks read from the network and not written to disk yet. The first one is being written.
+    Deque<Vector<char>> m_downloadBuffers;
+    bool m_isDownloadReadPaused { false };
+    bool m_didFinishDownloadRead { false };
     bool m_allowOverwriteDownload { false };
     WebCore::NetworkLoadMetrics m_networkLoadMetrics;
     MonotonicTime m_startTime;
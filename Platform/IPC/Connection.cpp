@@ -39,6 +39,7 @@
 #endif
 
 #if USE(UNIX_DOMAIN_SOCKETS)
+#include "SharedMessageBodyPool.h"
 #include "UnixMessage.h"
 #endif
 
@@ -446,22 +447,20 @@ std::unique_ptr<Decoder> Connection::waitForMessage(StringReference messageRecei
     bool hasIncomingSynchronousMessage = false;
 
     // First, check if this message is already in the incoming messages queue.
-    {
-        std::lock_guard<Lock> lock(m_incomingMessagesMutex);
-
-        for (auto it = m_incomingMessages.begin(), end = m_incomingMessages.end(); it != end; ++it) {
-            std::unique_ptr<Decoder>& message = *it;
+    takeEnqueuedIncomingMessages();
+    for (auto it = m_incomingMessages.begin(), end = m_incomingMessages.end(); it != end; ++it) {
+        std::unique_ptr<Decoder>& message = *it;
 
-            if (message->messageReceiverName() == messageReceiverName && message->messageName() == messageName && message->destinationID() == destinationID) {
-                std::unique_ptr<Decoder> returnedMessage = WTFMove(message);
-
-                m_incomingMessages.remove(it);
-                return returnedMessage;
-            }
+        if (message->messageReceiverName() == messageReceiverName && message->messageName() == messageName && message->destinationID() == destinationID) {
+            std::unique_ptr<Decoder> returnedMessage = WTFMove(message);
 
-            if (message->isSyncMessage())
-                hasIncomingSynchronousMessage = true;
+            m_incomingMessages.remove(it);
+            --m_pendingIncomingMessageCount;
+            return returnedMessage;
         }
+
+        if (message->isSyncMessage())
+            hasIncomingSynchronousMessage = true;
     }
 
     // Don't even start waiting if we have InterruptWaitingIfSyncMessageArrives and there's a sync message already in the queue.
@@ -749,8 +748,9 @@ void Connection::uninstallIncomingSyncMessageCallback(uint64_t callbackID)
 
 bool Connection::hasIncomingSyncMessage()
 {
-    std::lock_guard<Lock> lock(m_incomingMessagesMutex);
+    ASSERT(RunLoop::isMain());
 
+    takeEnqueuedIncomingMessages();
     for (auto& message : m_incomingMessages) {
         if (message->isSyncMessage())
             return true;
@@ -904,27 +904,26 @@ void Connection::didFailToSendSyncMessage()
 
 void Connection::enqueueIncomingMessage(std::unique_ptr<Decoder> incomingMessage)
 {
-    {
-        std::lock_guard<Lock> lock(m_incomingMessagesMutex);
-
 #if PLATFORM(COCOA)
-        if (m_wasKilled)
-            return;
+    if (m_wasKilled)
+        return;
 
-        if (m_incomingMessages.size() >= maxPendingIncomingMessagesKillingThreshold) {
-            if (kill()) {
-                RELEASE_LOG_ERROR(IPC, "%p - Connection::enqueueIncomingMessage: Over %zu incoming messages have been queued without the main thread processing them, killing the connection as the remote process seems to be misbehaving", this, maxPendingIncomingMessagesKillingThreshold);
-                m_incomingMessages.clear();
-            }
-            return;
-        }
+    if (m_pendingIncomingMessageCount.load() >= maxPendingIncomingMessagesKillingThreshold) {
+        // The main thread drops the messages that are still queued once it sees m_wasKilled.
+        if (kill())
+            RELEASE_LOG_ERROR(IPC, "%p - Connection::enqueueIncomingMessage: Over %zu incoming messages have been queued without the main thread processing them, killing the connection as the remote process seems to be misbehaving", this, maxPendingIncomingMessagesKillingThreshold);
+        return;
+    }
 #endif
 
-        m_incomingMessages.append(WTFMove(incomingMessage));
+    // Count the message before publishing it so the main thread never sees a message it hasn't been told about.
+    size_t previousPendingIncomingMessageCount = m_pendingIncomingMessageCount++;
+    m_enqueuedIncomingMessages.enqueue(WTFMove(incomingMessage));
 
-        if (m_incomingMessagesThrottler && m_incomingMessages.size() != 1)
-            return;
-    }
+    // With the throttler, a dispatch is already scheduled as long as there are pending messages
+    // (dispatchIncomingMessages() re-schedules itself until the count drops to zero).
+    if (m_incomingMessagesThrottler && previousPendingIncomingMessageCount)
+        return;
 
     RunLoop::main().dispatch([protectedThis = makeRef(*this)]() mutable {
         if (protectedThis->m_incomingMessagesThrottler)
@@ -1022,63 +1021,78 @@ size_t Connection::MessagesThrottler::numberOfMessagesToProcess(size_t totalMess
     return std::min(totalMessages, batchSize);
 }
 
-void Connection::dispatchOneIncomingMessage()
+void Connection::takeEnqueuedIncomingMessages()
 {
-    std::unique_ptr<Decoder> message;
-    {
-        std::lock_guard<Lock> lock(m_incomingMessagesMutex);
-        if (m_incomingMessages.isEmpty())
-            return;
+    ASSERT(RunLoop::isMain());
 
-        message = m_incomingMessages.takeFirst();
+    m_enqueuedIncomingMessages.takeAll([this](std::unique_ptr<Decoder>&& message) {
+        m_incomingMessages.append(WTFMove(message));
+    });
+
+#if PLATFORM(COCOA)
+    if (m_wasKilled) {
+        m_pendingIncomingMessageCount -= m_incomingMessages.size();
+        m_incomingMessages.clear();
     }
+#endif
+}
 
-    dispatchMessage(WTFMove(message));
+std::unique_ptr<Decoder> Connection::takeFirstIncomingMessage()
+{
+    ASSERT(RunLoop::isMain());
+    ASSERT(!m_incomingMessages.isEmpty());
+
+    --m_pendingIncomingMessageCount;
+    return m_incomingMessages.takeFirst();
 }
 
-void Connection::dispatchIncomingMessages()
+void Connection::dispatchOneIncomingMessage()
 {
     ASSERT(RunLoop::isMain());
 
-    std::unique_ptr<Decoder> message;
+    takeEnqueuedIncomingMessages();
+    if (m_incomingMessages.isEmpty())
+        return;
 
-    size_t messagesToProcess = 0;
-    {
-        std::lock_guard<Lock> lock(m_incomingMessagesMutex);
-        if (m_incomingMessages.isEmpty())
-            return;
+    dispatchMessage(takeFirstIncomingMessage());
+}
 
-        message = m_incomingMessages.takeFirst();
+void Connection::dispatchIncomingMessages()
+{
+    ASSERT(RunLoop::isMain());
+
+    takeEnqueuedIncomingMessages();
+    if (m_incomingMessages.isEmpty())
+        return;
 
-        // Incoming messages may get adding to the queue by the IPC thread while we're dispatching the messages below.
-        // To make sure dispatchIncomingMessages() yields, we only ever process messages that were in the queue when
-        // dispatchIncomingMessages() was called. Additionally, the MessageThrottler may further cap the number of
-        // messages to process to make sure we give the main run loop a chance to process other events.
-        messagesToProcess = m_incomingMessagesThrottler->numberOfMessagesToProcess(m_incomingMessages.size());
-        if (messagesToProcess < m_incomingMessages.size()) {
-            RELEASE_LOG_ERROR(IPC, "%p - Connection::dispatchIncomingMessages: IPC throttling was triggered (has %zu pending incoming messages, will only process %zu before yielding)", this, m_incomingMessages.size(), messagesToProcess);
+    std::unique_ptr<Decoder> message = takeFirstIncomingMessage();
+
+    // Incoming messages may get adding to the queue by the IPC thread while we're dispatching the messages below.
+    // To make sure dispatchIncomingMessages() yields, we only ever process messages that were in the queue when
+    // dispatchIncomingMessages() was called. Additionally, the MessageThrottler may further cap the number of
+    // messages to process to make sure we give the main run loop a chance to process other events.
+    size_t messagesToProcess = m_incomingMessagesThrottler->numberOfMessagesToProcess(m_incomingMessages.size());
+    if (messagesToProcess < m_incomingMessages.size()) {
+        RELEASE_LOG_ERROR(IPC, "%p - Connection::dispatchIncomingMessages: IPC throttling was triggered (has %zu pending incoming messages, will only process %zu before yielding)", this, m_incomingMessages.size(), messagesToProcess);
 #if PLATFORM(COCOA)
-            RELEASE_LOG_ERROR(IPC, "%p - Connection::dispatchIncomingMessages: first IPC message in queue is %{public}s::%{public}s", this, message->messageReceiverName().toString().data(), message->messageName().toString().data());
+        RELEASE_LOG_ERROR(IPC, "%p - Connection::dispatchIncomingMessages: first IPC message in queue is %{public}s::%{public}s", this, message->messageReceiverName().toString().data(), message->messageName().toString().data());
 #endif
-        }
-
-        // Re-schedule ourselves *before* we dispatch the messages because we want to process follow-up messages if the client
-        // spins a nested run loop while we're dispatching a message. Note that this means we can re-enter this method.
-        if (!m_incomingMessages.isEmpty())
-            m_incomingMessagesThrottler->scheduleMessagesDispatch();
     }
 
+    // Re-schedule ourselves *before* we dispatch the messages because we want to process follow-up messages if the client
+    // spins a nested run loop while we're dispatching a message. Note that this means we can re-enter this method.
+    // The pending count also covers messages the IPC thread enqueued after takeEnqueuedIncomingMessages(), which
+    // didn't schedule a dispatch of their own.
+    if (m_pendingIncomingMessageCount.load())
+        m_incomingMessagesThrottler->scheduleMessagesDispatch();
+
     dispatchMessage(WTFMove(message));
 
     for (size_t i = 1; i < messagesToProcess; ++i) {
-        {
-            std::lock_guard<Lock> lock(m_incomingMessagesMutex);
-            if (m_incomingMessages.isEmpty())
-                return;
+        if (m_incomingMessages.isEmpty())
+            return;
 
-            message = m_incomingMessages.takeFirst();
-        }
-        dispatchMessage(WTFMove(message));
+        dispatchMessage(takeFirstIncomingMessage());
     }
 }
 
@@ -31,6 +31,7 @@
 #include "Decoder.h"
 #include "Encoder.h"
 #include "HandleMessage.h"
+#include "IncomingMessageQueue.h"
 #include "MessageReceiver.h"
 #include <WebCore/ScriptDisallowedScope.h>
 #include <atomic>
@@ -84,7 +85,9 @@ enum class WaitForOption {
 while (0)
 
 class MachMessage;
+class SharedMessageBodyPool;
 class UnixMessage;
+class UnixMessageBatch;
 
 class Connection : public ThreadSafeRefCounted<Connection> {
 public:
@@ -244,6 +247,8 @@ private:
 
     // Can be called on any thread.
     void enqueueIncomingMessage(std::unique_ptr<Decoder>);
+    void takeEnqueuedIncomingMessages();
+    std::unique_ptr<Decoder> takeFirstIncomingMessage();
     size_t incomingMessagesDispatchingBatchSize() const;
 
     void willSendSyncMessage(OptionSet<SendSyncOption>);
@@ -292,9 +297,12 @@ private:
     bool m_ignoreTimeoutsForTesting { false };
     bool m_didReceiveInvalidMessage;
 
-    // Incoming messages.
-    Lock m_incomingMessagesMutex;
+    // Incoming messages. The IPC thread enqueues them without locking and the main thread moves
+    // them to m_incomingMessages, which is only used on the main thread.
+    IncomingMessageQueue m_enqueuedIncomingMessages;
     Deque<std::unique_ptr<Decoder>> m_incomingMessages;
+    // Messages that are either in m_enqueuedIncomingMessages or in m_incomingMessages.
+    std::atomic<size_t> m_pendingIncomingMessageCount { 0 };
     std::unique_ptr<MessagesThrottler> m_incomingMessagesThrottler;
 
     // Outgoing messages.
@@ -333,12 +341,20 @@ private:
     // Called on the connection queue.
     void readyReadHandler();
     bool processMessage();
-    bool sendOutputMessage(UnixMessage&);
+    size_t processMessage(const uint8_t* messageData, size_t availableSize);
+    std::unique_ptr<UnixMessage> createOutputMessage(Encoder&);
+    bool sendOutputMessages(Deque<std::unique_ptr<UnixMessage>>&);
 
     Vector<uint8_t> m_readBuffer;
+    size_t m_readBufferOffset { 0 };
     Vector<int> m_fileDescriptors;
+#if OS(LINUX)
+    std::unique_ptr<UnixMessageBatch> m_receivedMessageBatch;
+#endif
     int m_socketDescriptor;
-    std::unique_ptr<UnixMessage> m_pendingOutputMessage;
+    Deque<std::unique_ptr<UnixMessage>> m_pendingOutputMessages;
+    std::unique_ptr<SharedMessageBodyPool> m_outgoingMessageBodyPool;
+    std::unique_ptr<SharedMessageBodyPool> m_incomingMessageBodyPool;
 #if USE(GLIB)
     GRefPtr<GSocket> m_socket;
     GSocketMonitor m_readSocketMonitor;
@@ -360,7 +376,7 @@ private:
     bool m_isInitializingSendSource { false };
 
     OSObjectPtr<xpc_connection_t> m_xpcConnection;
-    bool m_wasKilled { false };
+    std::atomic<bool> m_wasKilled { false };
 #elif OS(WINDOWS)
     // Called on the connection queue.
     void readEventHandler();
@@ -162,6 +162,8 @@ public:
     static const bool isIPCDecoder = true;
 
 private:
+    friend class IncomingMessageQueue;
+
     bool alignBufferPosition(unsigned alignment, size_t);
     bool bufferIsLargeEnoughToContain(unsigned alignment, size_t) const;
     template<typename Type> Decoder& getOptional(std::optional<Type>&);
@@ -179,6 +181,8 @@ private:
 
     uint64_t m_destinationID;
 
+    Decoder* m_nextIncomingMessage { nullptr };
+
 #if PLATFORM(MAC)
     std::unique_ptr<ImportanceAssertion> m_importanceAssertion;
 #endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "Decoder.h"
+#include <atomic>
+#include <wtf/Noncopyable.h>
+
+namespace IPC {
+
+// A lock-free queue of incoming messages. Any number of threads can enqueue messages while a
+// single consumer takes all of them at once, in the order they were enqueued. Messages are linked
+// through the Decoder itself so enqueueing doesn't allocate.
+class IncomingMessageQueue {
+    WTF_MAKE_NONCOPYABLE(IncomingMessageQueue);
+public:
+    IncomingMessageQueue() = default;
+
+    ~IncomingMessageQueue()
+    {
+        takeAll([](std::unique_ptr<Decoder>&&) { });
+    }
+
+    void enqueue(std::unique_ptr<Decoder>&& message)
+    {
+        Decoder* node = message.release();
+        Decoder* head = m_head.load(std::memory_order_relaxed);
+        do {
+            node->m_nextIncomingMessage = head;
+        } while (!m_head.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    template<typename Function>
+    void takeAll(const Function& function)
+    {
+        Decoder* node = m_head.exchange(nullptr, std::memory_order_acquire);
+        if (!node)
+            return;
+
+        // The list is in reverse enqueueing order.
+        Decoder* first = nullptr;
+        while (node) {
+            Decoder* next = node->m_nextIncomingMessage;
+            node->m_nextIncomingMessage = first;
+            first = node;
+            node = next;
+        }
+
+        while (first) {
+            Decoder* next = first->m_nextIncomingMessage;
+            first->m_nextIncomingMessage = nullptr;
+            function(std::unique_ptr<Decoder>(first));
+            first = next;
+        }
+    }
+
+    bool isEmpty() const { return !m_head.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<Decoder*> m_head { nullptr };
+};
+
+} // namespace IPC
@@ -30,6 +30,7 @@
 
 #include "DataReference.h"
 #include "SharedMemory.h"
+#include "SharedMessageBodyPool.h"
 #include "UnixMessage.h"
 #include <sys/socket.h>
 #include <unistd.h>
@@ -48,6 +49,10 @@
 // than in traditional Unix so fallback to STREAM on that platform.
 #if defined(SOCK_SEQPACKET) && !OS(DARWIN)
 #define SOCKET_TYPE SOCK_SEQPACKET
+#if OS(LINUX)
+// Every packet holds exactly one message, so several of them can be received or sent with a single system call.
+#define HAVE_SOCKET_MESSAGE_BATCHING 1
+#endif
 #else
 #if USE(GLIB)
 #define SOCKET_TYPE SOCK_STREAM
@@ -60,6 +65,11 @@ namespace IPC {
 
 static const size_t messageMaxSize = 4096;
 static const size_t attachmentMaxAmount = 255;
+#if HAVE(SOCKET_MESSAGE_BATCHING)
+static const size_t maximumBatchedMessageCount = 16;
+#else
+static const size_t maximumBatchedMessageCount = 1;
+#endif
 
 class AttachmentInfo {
     WTF_MAKE_FAST_ALLOCATED;
@@ -96,8 +106,14 @@ void Connection::platformInitialize(Identifier identifier)
 #if USE(GLIB)
     m_socket = adoptGRef(g_socket_new_from_fd(m_socketDescriptor, nullptr));
 #endif
+#if HAVE(SOCKET_MESSAGE_BATCHING)
+    m_receivedMessageBatch = std::make_unique<UnixMessageBatch>(maximumBatchedMessageCount, messageMaxSize, CMSG_SPACE(sizeof(int) * attachmentMaxAmount));
+#else
     m_readBuffer.reserveInitialCapacity(messageMaxSize);
+#endif
     m_fileDescriptors.reserveInitialCapacity(attachmentMaxAmount);
+    m_outgoingMessageBodyPool = std::make_unique<SharedMessageBodyPool>();
+    m_incomingMessageBodyPool = std::make_unique<SharedMessageBodyPool>();
 }
 
 void Connection::platformInvalidate()
@@ -124,22 +140,36 @@ void Connection::platformInvalidate()
 
 bool Connection::processMessage()
 {
-    if (m_readBuffer.size() < sizeof(MessageInfo))
+    size_t messageLength = processMessage(m_readBuffer.data() + m_readBufferOffset, m_readBuffer.size() - m_readBufferOffset);
+    if (!messageLength)
         return false;
 
-    uint8_t* messageData = m_readBuffer.data();
+    // Consumed messages are skipped rather than removed, the buffer gets compacted before the next read.
+    m_readBufferOffset += messageLength;
+    if (m_readBufferOffset == m_readBuffer.size()) {
+        m_readBuffer.shrink(0);
+        m_readBufferOffset = 0;
+    }
+    return true;
+}
+
+size_t Connection::processMessage(const uint8_t* messageData, size_t availableSize)
+{
+    if (availableSize < sizeof(MessageInfo))
+        return 0;
+
     MessageInfo messageInfo;
     memcpy(&messageInfo, messageData, sizeof(messageInfo));
     messageData += sizeof(messageInfo);
 
     if (messageInfo.attachmentCount() > attachmentMaxAmount || (!messageInfo.isBodyOutOfLine() && messageInfo.bodySize() > messageMaxSize)) {
         ASSERT_NOT_REACHED();
-        return false;
+        return 0;
     }
 
     size_t messageLength = sizeof(MessageInfo) + messageInfo.attachmentCount() * sizeof(AttachmentInfo) + (messageInfo.isBodyOutOfLine() ? 0 : messageInfo.bodySize());
-    if (m_readBuffer.size() < messageLength)
-        return false;
+    if (availableSize < messageLength)
+        return 0;
 
     size_t attachmentFileDescriptorCount = 0;
     size_t attachmentCount = messageInfo.attachmentCount();
@@ -162,7 +192,7 @@ bool Connection::processMessage()
             }
         }
 
-        if (messageInfo.isBodyOutOfLine())
+        if (messageInfo.hasBodyAttachment())
             attachmentCount--;
     }
 
@@ -190,12 +220,33 @@ bool Connection::processMessage()
         }
     }
 
-    if (messageInfo.isBodyOutOfLine()) {
+    const uint8_t* sharedSlotBody = nullptr;
+    if (messageInfo.isBodyInSharedSlot()) {
+        ASSERT(messageInfo.bodySize());
+
+        if (messageInfo.hasBodyAttachment()) {
+            if (attachmentInfo[attachmentCount].isNull()) {
+                ASSERT_NOT_REACHED();
+                return 0;
+            }
+
+            if (!m_incomingMessageBodyPool->adoptSlot(messageInfo.bodySlot(), IPC::Attachment(m_fileDescriptors[attachmentFileDescriptorCount - 1], attachmentInfo[attachmentCount].size()))) {
+                ASSERT_NOT_REACHED();
+                return 0;
+            }
+        }
+
+        sharedSlotBody = m_incomingMessageBodyPool->receivedBody(messageInfo.bodySlot(), messageInfo.bodySize());
+        if (!sharedSlotBody) {
+            ASSERT_NOT_REACHED();
+            return 0;
+        }
+    } else if (messageInfo.isBodyOutOfLine()) {
         ASSERT(messageInfo.bodySize());
 
         if (attachmentInfo[attachmentCount].isNull() || attachmentInfo[attachmentCount].size() != messageInfo.bodySize()) {
             ASSERT_NOT_REACHED();
-            return false;
+            return 0;
         }
 
         WebKit::SharedMemory::Handle handle;
@@ -204,26 +255,25 @@ bool Connection::processMessage()
         oolMessageBody = WebKit::SharedMemory::map(handle, WebKit::SharedMemory::Protection::ReadOnly);
         if (!oolMessageBody) {
             ASSERT_NOT_REACHED();
-            return false;
+            return 0;
         }
     }
 
-    ASSERT(attachments.size() == (messageInfo.isBodyOutOfLine() ? messageInfo.attachmentCount() - 1 : messageInfo.attachmentCount()));
+    ASSERT(attachments.size() == (messageInfo.hasBodyAttachment() ? messageInfo.attachmentCount() - 1 : messageInfo.attachmentCount()));
 
-    uint8_t* messageBody = messageData;
-    if (messageInfo.isBodyOutOfLine())
+    const uint8_t* messageBody = messageData;
+    if (sharedSlotBody)
+        messageBody = sharedSlotBody;
+    else if (messageInfo.isBodyOutOfLine())
         messageBody = reinterpret_cast<uint8_t*>(oolMessageBody->data());
 
+    // The decoder copies the body so the slot can be handed back to the sender right away.
     auto decoder = std::make_unique<Decoder>(messageBody, messageInfo.bodySize(), nullptr, WTFMove(attachments));
+    if (sharedSlotBody)
+        m_incomingMessageBodyPool->releaseReceivedBody(messageInfo.bodySlot());
 
     processIncomingMessage(WTFMove(decoder));
 
-    if (m_readBuffer.size() > messageLength) {
-        memmove(m_readBuffer.data(), m_readBuffer.data() + messageLength, m_readBuffer.size() - messageLength);
-        m_readBuffer.shrink(m_readBuffer.size() - messageLength);
-    } else
-        m_readBuffer.shrink(0);
-
     if (attachmentFileDescriptorCount) {
         if (m_fileDescriptors.size() > attachmentFileDescriptorCount) {
             memmove(m_fileDescriptors.data(), m_fileDescriptors.data() + attachmentFileDescriptorCount, (m_fileDescriptors.size() - attachmentFileDescriptorCount) * sizeof(int));
@@ -232,10 +282,35 @@ bool Connection::processMessage()
             m_fileDescriptors.shrink(0);
     }
 
+    return messageLength;
+}
 
-    return true;
+static void readFileDescriptors(struct msghdr& message, Vector<int>& fileDescriptors)
+{
+    struct cmsghdr* controlMessage;
+    for (controlMessage = CMSG_FIRSTHDR(&message); controlMessage; controlMessage = CMSG_NXTHDR(&message, controlMessage)) {
+        if (controlMessage->cmsg_level == SOL_SOCKET && controlMessage->cmsg_type == SCM_RIGHTS) {
+            if (controlMessage->cmsg_len < CMSG_LEN(0) || controlMessage->cmsg_len > attachmentMaxAmount) {
+                ASSERT_NOT_REACHED();
+                break;
+            }
+            size_t previousFileDescriptorsSize = fileDescriptors.size();
+            size_t fileDescriptorsCount = (controlMessage->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            fileDescriptors.grow(fileDescriptors.size() + fileDescriptorsCount);
+            memcpy(fileDescriptors.data() + previousFileDescriptorsSize, CMSG_DATA(controlMessage), sizeof(int) * fileDescriptorsCount);
+
+            for (size_t i = 0; i < fileDescriptorsCount; ++i) {
+                if (!setCloseOnExec(fileDescriptors[previousFileDescriptorsSize + i])) {
+                    ASSERT_NOT_REACHED();
+                    break;
+                }
+            }
+            break;
+        }
+    }
 }
 
+#if !HAVE(SOCKET_MESSAGE_BATCHING)
 static ssize_t readBytesFromSocket(int socketDescriptor, Vector<uint8_t>& buffer, Vector<int>& fileDescriptors)
 {
     struct msghdr message;
@@ -268,27 +343,7 @@ static ssize_t readBytesFromSocket(int socketDescriptor, Vector<uint8_t>& buffer
             return -1;
         }
 
-        struct cmsghdr* controlMessage;
-        for (controlMessage = CMSG_FIRSTHDR(&message); controlMessage; controlMessage = CMSG_NXTHDR(&message, controlMessage)) {
-            if (controlMessage->cmsg_level == SOL_SOCKET && controlMessage->cmsg_type == SCM_RIGHTS) {
-                if (controlMessage->cmsg_len < CMSG_LEN(0) || controlMessage->cmsg_len > attachmentMaxAmount) {
-                    ASSERT_NOT_REACHED();
-                    break;
-                }
-                size_t previousFileDescriptorsSize = fileDescriptors.size();
-                size_t fileDescriptorsCount = (controlMessage->cmsg_len - CMSG_LEN(0)) / sizeof(int);
-                fileDescriptors.grow(fileDescriptors.size() + fileDescriptorsCount);
-                memcpy(fileDescriptors.data() + previousFileDescriptorsSize, CMSG_DATA(controlMessage), sizeof(int) * fileDescriptorsCount);
-
-                for (size_t i = 0; i < fileDescriptorsCount; ++i) {
-                    if (!setCloseOnExec(fileDescriptors[previousFileDescriptorsSize + i])) {
-                        ASSERT_NOT_REACHED();
-                        break;
-                    }
-                }
-                break;
-            }
-        }
+        readFileDescriptors(message, fileDescriptors);
 
         buffer.shrink(previousBufferSize + bytesRead);
         return bytesRead;
@@ -296,10 +351,67 @@ static ssize_t readBytesFromSocket(int socketDescriptor, Vector<uint8_t>& buffer
 
     return -1;
 }
+#endif
+
+#if HAVE(SOCKET_MESSAGE_BATCHING)
+static int readMessagesFromSocket(int socketDescriptor, UnixMessageBatch& batch)
+{
+    while (true) {
+        batch.reset();
+        int messageCount = recvmmsg(socketDescriptor, batch.headers(), batch.packetCount(), 0, nullptr);
+        if (messageCount < 0 && errno == EINTR)
+            continue;
+        return messageCount;
+    }
+}
+#endif
 
 void Connection::readyReadHandler()
 {
     while (true) {
+#if HAVE(SOCKET_MESSAGE_BATCHING)
+        int messageCount = readMessagesFromSocket(m_socketDescriptor, *m_receivedMessageBatch);
+        if (messageCount < 0) {
+            // EINTR was already handled by readMessagesFromSocket.
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+
+            if (m_isConnected) {
+                WTFLogAlways("Error receiving IPC message on socket %d in process %d: %s", m_socketDescriptor, getpid(), strerror(errno));
+                connectionDidClose();
+            }
+            return;
+        }
+
+        for (int i = 0; i < messageCount; ++i) {
+            auto& message = m_receivedMessageBatch->header(i);
+            // An empty packet means the other end closed the connection.
+            if (!message.msg_len) {
+                connectionDidClose();
+                return;
+            }
+
+            readFileDescriptors(message.msg_hdr, m_fileDescriptors);
+
+            // Every packet holds exactly one message, and all the file descriptors sent with it.
+            bool isValidMessage = !(message.msg_hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+                && processMessage(m_receivedMessageBatch->packet(i), message.msg_len) == message.msg_len
+                && m_fileDescriptors.isEmpty();
+            if (!isValidMessage) {
+                WTFLogAlways("Received an invalid IPC message on socket %d in process %d", m_socketDescriptor, getpid());
+                connectionDidClose();
+                return;
+            }
+        }
+#else
+        if (m_readBufferOffset) {
+            // Only the start of a message that didn't fully arrive yet can be left.
+            size_t remainingSize = m_readBuffer.size() - m_readBufferOffset;
+            memmove(m_readBuffer.data(), m_readBuffer.data() + m_readBufferOffset, remainingSize);
+            m_readBuffer.shrink(remainingSize);
+            m_readBufferOffset = 0;
+        }
+
         ssize_t bytesRead = readBytesFromSocket(m_socketDescriptor, m_readBuffer, m_fileDescriptors);
 
         if (bytesRead < 0) {
@@ -324,6 +436,7 @@ void Connection::readyReadHandler()
             if (!processMessage())
                 break;
         }
+#endif
     }
 }
 
@@ -366,48 +479,105 @@ bool Connection::open()
 
 bool Connection::platformCanSendOutgoingMessages() const
 {
-    return !m_pendingOutputMessage;
+    return m_pendingOutputMessages.isEmpty();
 }
 
-bool Connection::sendOutgoingMessage(std::unique_ptr<Encoder> encoder)
+std::unique_ptr<UnixMessage> Connection::createOutputMessage(Encoder& encoder)
 {
     COMPILE_ASSERT(sizeof(MessageInfo) + attachmentMaxAmount * sizeof(size_t) <= messageMaxSize, AttachmentsFitToMessageInline);
 
-    UnixMessage outputMessage(*encoder);
-    if (outputMessage.attachments().size() > (attachmentMaxAmount - 1)) {
+    auto outputMessage = std::make_unique<UnixMessage>(encoder);
+    if (outputMessage->attachments().size() > (attachmentMaxAmount - 1)) {
         ASSERT_NOT_REACHED();
-        return false;
+        return nullptr;
     }
 
-    size_t messageSizeWithBodyInline = sizeof(MessageInfo) + (outputMessage.attachments().size() * sizeof(AttachmentInfo)) + outputMessage.bodySize();
-    if (messageSizeWithBodyInline > messageMaxSize && outputMessage.bodySize()) {
-        RefPtr<WebKit::SharedMemory> oolMessageBody = WebKit::SharedMemory::allocate(encoder->bufferSize());
+    size_t messageSizeWithBodyInline = sizeof(MessageInfo) + (outputMessage->attachments().size() * sizeof(AttachmentInfo)) + outputMessage->bodySize();
+    if (messageSizeWithBodyInline > messageMaxSize && outputMessage->bodySize()) {
+        if (auto reservation = m_outgoingMessageBodyPool->reserve(outputMessage->bodySize())) {
+            memcpy(reservation->data, outputMessage->body(), outputMessage->bodySize());
+            outputMessage->messageInfo().setBodyInSharedSlot(reservation->slot, reservation->isNewSlot);
+            if (reservation->isNewSlot)
+                outputMessage->appendAttachment(WTFMove(reservation->attachment));
+            return outputMessage;
+        }
+
+        // The body is too large for the pool or the other side is still reading all the slots.
+        RefPtr<WebKit::SharedMemory> oolMessageBody = WebKit::SharedMemory::allocate(encoder.bufferSize());
         if (!oolMessageBody)
-            return false;
+            return nullptr;
 
         WebKit::SharedMemory::Handle handle;
         if (!oolMessageBody->createHandle(handle, WebKit::SharedMemory::Protection::ReadOnly))
-            return false;
+            return nullptr;
 
-        outputMessage.messageInfo().setBodyOutOfLine();
+        outputMessage->messageInfo().setBodyOutOfLine();
 
-        memcpy(oolMessageBody->data(), outputMessage.body(), outputMessage.bodySize());
+        memcpy(oolMessageBody->data(), outputMessage->body(), outputMessage->bodySize());
 
-        outputMessage.appendAttachment(handle.releaseAttachment());
+        outputMessage->appendAttachment(handle.releaseAttachment());
     }
 
-    return sendOutputMessage(outputMessage);
+    return outputMessage;
 }
 
-bool Connection::sendOutputMessage(UnixMessage& outputMessage)
+bool Connection::sendOutgoingMessage(std::unique_ptr<Encoder> encoder)
 {
-    ASSERT(!m_pendingOutputMessage);
+    Vector<std::unique_ptr<Encoder>, maximumBatchedMessageCount> encoders;
+    encoders.append(WTFMove(encoder));
 
+#if HAVE(SOCKET_MESSAGE_BATCHING)
+    // Send the messages that are already queued along with this one.
+    {
+        std::lock_guard<Lock> lock(m_outgoingMessagesMutex);
+        while (encoders.size() < maximumBatchedMessageCount && !m_outgoingMessages.isEmpty())
+            encoders.append(m_outgoingMessages.takeFirst());
+    }
+#endif
+
+    // Output messages point to the encoder buffers, which must stay alive until the messages are sent.
+    Deque<std::unique_ptr<UnixMessage>> outputMessages;
+    for (size_t i = 0; i < encoders.size(); ++i) {
+        auto outputMessage = createOutputMessage(*encoders[i]);
+        if (!outputMessage) {
+            // Like a single message that can't be sent, drop it and stop sending. Later messages go back to the queue.
+            {
+                std::lock_guard<Lock> lock(m_outgoingMessagesMutex);
+                for (size_t j = encoders.size(); j > i + 1; --j)
+                    m_outgoingMessages.prepend(WTFMove(encoders[j - 1]));
+            }
+            sendOutputMessages(outputMessages);
+            return false;
+        }
+        outputMessages.append(WTFMove(outputMessage));
+    }
+
+    return sendOutputMessages(outputMessages);
+}
+
+class SocketMessage {
+    WTF_MAKE_NONCOPYABLE(SocketMessage);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    SocketMessage() = default;
+
+    void initialize(UnixMessage&);
+    struct msghdr& header() { return m_header; }
+
+private:
+    struct msghdr m_header;
+    struct iovec m_iov[3];
+    Vector<AttachmentInfo> m_attachmentInfo;
+    MallocPtr<char> m_attachmentFDBuffer;
+};
+
+void SocketMessage::initialize(UnixMessage& outputMessage)
+{
     auto& messageInfo = outputMessage.messageInfo();
-    struct msghdr message;
+    auto& message = m_header;
     memset(&message, 0, sizeof(message));
 
-    struct iovec iov[3];
+    auto& iov = m_iov;
     memset(&iov, 0, sizeof(iov));
 
     message.msg_iov = iov;
@@ -416,9 +586,6 @@ bool Connection::sendOutputMessage(UnixMessage& outputMessage)
     iov[0].iov_base = reinterpret_cast<void*>(&messageInfo);
     iov[0].iov_len = sizeof(messageInfo);
 
-    Vector<AttachmentInfo> attachmentInfo;
-    MallocPtr<char> attachmentFDBuffer;
-
     auto& attachments = outputMessage.attachments();
     if (!attachments.isEmpty()) {
         int* fdPtr = 0;
@@ -429,9 +596,9 @@ bool Connection::sendOutputMessage(UnixMessage& outputMessage)
             });
 
         if (attachmentFDBufferLength) {
-            attachmentFDBuffer = MallocPtr<char>::malloc(sizeof(char) * CMSG_SPACE(sizeof(int) * attachmentFDBufferLength));
+            m_attachmentFDBuffer = MallocPtr<char>::malloc(sizeof(char) * CMSG_SPACE(sizeof(int) * attachmentFDBufferLength));
 
-            message.msg_control = attachmentFDBuffer.get();
+            message.msg_control = m_attachmentFDBuffer.get();
             message.msg_controllen = CMSG_SPACE(sizeof(int) * attachmentFDBufferLength);
             memset(message.msg_control, 0, message.msg_controllen);
 
@@ -443,21 +610,21 @@ bool Connection::sendOutputMessage(UnixMessage& outputMessage)
             fdPtr = reinterpret_cast<int*>(CMSG_DATA(cmsg));
         }
 
-        attachmentInfo.resize(attachments.size());
+        m_attachmentInfo.resize(attachments.size());
         int fdIndex = 0;
         for (size_t i = 0; i < attachments.size(); ++i) {
-            attachmentInfo[i].setType(attachments[i].type());
+            m_attachmentInfo[i].setType(attachments[i].type());
 
             switch (attachments[i].type()) {
             case Attachment::MappedMemoryType:
-                attachmentInfo[i].setSize(attachments[i].size());
+                m_attachmentInfo[i].setSize(attachments[i].size());
                 FALLTHROUGH;
             case Attachment::SocketType:
                 if (attachments[i].fileDescriptor() != -1) {
                     ASSERT(fdPtr);
                     fdPtr[fdIndex++] = attachments[i].fileDescriptor();
                 } else
-                    attachmentInfo[i].setNull();
+                    m_attachmentInfo[i].setNull();
                 break;
             case Attachment::Uninitialized:
             default:
@@ -465,7 +632,7 @@ bool Connection::sendOutputMessage(UnixMessage& outputMessage)
             }
         }
 
-        iov[iovLength].iov_base = attachmentInfo.data();
+        iov[iovLength].iov_base = m_attachmentInfo.data();
         iov[iovLength].iov_len = sizeof(AttachmentInfo) * attachments.size();
         ++iovLength;
     }
@@ -477,22 +644,53 @@ bool Connection::sendOutputMessage(UnixMessage& outputMessage)
     }
 
     message.msg_iovlen = iovLength;
+}
+
+bool Connection::sendOutputMessages(Deque<std::unique_ptr<UnixMessage>>& outputMessages)
+{
+    ASSERT(m_pendingOutputMessages.isEmpty());
+
+    while (!outputMessages.isEmpty()) {
+        size_t messageCount = std::min(outputMessages.size(), maximumBatchedMessageCount);
+        SocketMessage socketMessages[maximumBatchedMessageCount];
+        auto outputMessage = outputMessages.begin();
+        for (size_t i = 0; i < messageCount; ++i, ++outputMessage)
+            socketMessages[i].initialize(**outputMessage);
+
+#if HAVE(SOCKET_MESSAGE_BATCHING)
+        struct mmsghdr messages[maximumBatchedMessageCount];
+        memset(&messages, 0, sizeof(messages));
+        for (size_t i = 0; i < messageCount; ++i)
+            messages[i].msg_hdr = socketMessages[i].header();
+
+        int sentMessageCount = sendmmsg(m_socketDescriptor, messages, messageCount, 0);
+#else
+        int sentMessageCount = sendmsg(m_socketDescriptor, &socketMessages[0].header(), 0) == -1 ? -1 : 1;
+#endif
+
+        if (sentMessageCount >= 0) {
+            for (int i = 0; i < sentMessageCount; ++i)
+                outputMessages.removeFirst();
+            continue;
+        }
 
-    while (sendmsg(m_socketDescriptor, &message, 0) == -1) {
         if (errno == EINTR)
             continue;
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
 #if USE(GLIB)
-            m_pendingOutputMessage = std::make_unique<UnixMessage>(WTFMove(outputMessage));
+            // The encoders are about to go away, the pending messages take a copy of their bodies.
+            while (!outputMessages.isEmpty())
+                m_pendingOutputMessages.append(std::make_unique<UnixMessage>(WTFMove(*outputMessages.takeFirst())));
             m_writeSocketMonitor.start(m_socket.get(), G_IO_OUT, m_connectionQueue->runLoop(), [this, protectedThis = makeRef(*this)] (GIOCondition condition) -> gboolean {
                 if (condition & G_IO_OUT) {
-                    ASSERT(m_pendingOutputMessage);
+                    ASSERT(!m_pendingOutputMessages.isEmpty());
                     // We can't stop the monitor from this lambda, because stop destroys the lambda.
                     m_connectionQueue->dispatch([this, protectedThis = makeRef(*this)] {
                         m_writeSocketMonitor.stop();
-                        auto message = WTFMove(m_pendingOutputMessage);
+                        Deque<std::unique_ptr<UnixMessage>> messages;
+                        messages.swap(m_pendingOutputMessages);
                         if (m_isConnected) {
-                            sendOutputMessage(*message);
+                            sendOutputMessages(messages);
                             sendOutgoingMessages();
                         }
                     });
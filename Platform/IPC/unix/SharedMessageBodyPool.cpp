@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "SharedMessageBodyPool.h"
+
+#include "SharedMemory.h"
+#include <atomic>
+#include <wtf/MathExtras.h>
+
+namespace IPC {
+
+static const size_t minimumSlotSize = 64 * 1024;
+// Slots live as long as the connection, so keep them small enough that the pool pins at most a few megabytes.
+// Larger bodies are rare and use one-off shared memory that goes away with the message.
+static const size_t maximumSlotSize = 1024 * 1024;
+
+// The header keeps the body 16 bytes aligned.
+static const size_t slotHeaderSize = 16;
+
+enum SlotState : uint32_t {
+    SlotFree = 0,
+    SlotInUse = 1,
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "The slot state is shared between processes and must not rely on a lock");
+
+static std::atomic<uint32_t>& slotState(const WebKit::SharedMemory& memory)
+{
+    return *static_cast<std::atomic<uint32_t>*>(memory.data());
+}
+
+SharedMessageBodyPool::SharedMessageBodyPool() = default;
+SharedMessageBodyPool::~SharedMessageBodyPool() = default;
+
+std::optional<SharedMessageBodyPool::Reservation> SharedMessageBodyPool::reserve(size_t bodySize)
+{
+    size_t requiredSize = slotHeaderSize + bodySize;
+    if (requiredSize > maximumSlotSize)
+        return std::nullopt;
+
+    std::optional<unsigned> slotToReplace;
+    for (unsigned slot = 0; slot < slotCount; ++slot) {
+        auto& memory = m_slots[slot];
+        if (!memory) {
+            if (!slotToReplace)
+                slotToReplace = slot;
+            continue;
+        }
+        if (slotState(*memory).load(std::memory_order_acquire) != SlotFree)
+            continue;
+        if (memory->size() < requiredSize) {
+            if (!slotToReplace)
+                slotToReplace = slot;
+            continue;
+        }
+
+        slotState(*memory).store(SlotInUse, std::memory_order_relaxed);
+        return Reservation { slot, static_cast<uint8_t*>(memory->data()) + slotHeaderSize, false, { } };
+    }
+
+    if (!slotToReplace)
+        return std::nullopt;
+
+    // Shared memory is zero filled so the new slot starts free.
+    auto memory = WebKit::SharedMemory::allocate(std::max<size_t>(minimumSlotSize, roundUpToPowerOfTwo(requiredSize)));
+    if (!memory)
+        return std::nullopt;
+
+    WebKit::SharedMemory::Handle handle;
+    if (!memory->createHandle(handle, WebKit::SharedMemory::Protection::ReadWrite))
+        return std::nullopt;
+
+    slotState(*memory).store(SlotInUse, std::memory_order_relaxed);
+    auto* data = static_cast<uint8_t*>(memory->data()) + slotHeaderSize;
+    m_slots[*slotToReplace] = WTFMove(memory);
+    return Reservation { *slotToReplace, data, true, handle.releaseAttachment() };
+}
+
+bool SharedMessageBodyPool::adoptSlot(unsigned slot, Attachment&& attachment)
+{
+    if (slot >= slotCount)
+        return false;
+
+    WebKit::SharedMemory::Handle handle;
+    handle.adoptAttachment(WTFMove(attachment));
+
+    auto memory = WebKit::SharedMemory::map(handle, WebKit::SharedMemory::Protection::ReadWrite);
+    if (!memory || memory->size() < slotHeaderSize || memory->size() > maximumSlotSize)
+        return false;
+
+    m_slots[slot] = WTFMove(memory);
+    return true;
+}
+
+const uint8_t* SharedMessageBodyPool::receivedBody(unsigned slot, size_t bodySize) const
+{
+    if (slot >= slotCount || !m_slots[slot])
+        return nullptr;
+
+    auto& memory = *m_slots[slot];
+    if (bodySize > memory.size() - slotHeaderSize)
+        return nullptr;
+    if (slotState(memory).load(std::memory_order_acquire) != SlotInUse)
+        return nullptr;
+
+    return static_cast<const uint8_t*>(memory.data()) + slotHeaderSize;
+}
+
+void SharedMessageBodyPool::releaseReceivedBody(unsigned slot)
+{
+    ASSERT(slot < slotCount && m_slots[slot]);
+
+    // Make sure the body has been read before the sender gets to overwrite it.
+    slotState(*m_slots[slot]).store(SlotFree, std::memory_order_release);
+}
+
+} // namespace IPC
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "Attachment.h"
+#include <array>
+#include <wtf/Optional.h>
+#include <wtf/RefPtr.h>
+
+namespace WebKit {
+class SharedMemory;
+}
+
+namespace IPC {
+
+// Reusable shared memory regions for message bodies that don't fit in a socket packet.
+// The memory of a slot is sent to the other side along with the first message using it, later messages
+// only carry the slot index. Each region starts with a flag that the receiver clears once it has consumed
+// the body, which is the credit that allows the sender to reuse the slot. Slots are never released, so their
+// size is capped and bodies that don't fit are left to one-off shared memory.
+class SharedMessageBodyPool {
+    WTF_MAKE_NONCOPYABLE(SharedMessageBodyPool);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    SharedMessageBodyPool();
+    ~SharedMessageBodyPool();
+
+    static const unsigned slotCount = 4;
+
+    struct Reservation {
+        unsigned slot;
+        uint8_t* data;
+        // Set when the receiver doesn't have the slot memory yet.
+        bool isNewSlot;
+        Attachment attachment;
+    };
+    // Returns nullopt when the body is too large or all the slots are still being read by the receiver.
+    std::optional<Reservation> reserve(size_t bodySize);
+
+    bool adoptSlot(unsigned slot, Attachment&&);
+    const uint8_t* receivedBody(unsigned slot, size_t bodySize) const;
+    void releaseReceivedBody(unsigned slot);
+
+private:
+    std::array<RefPtr<WebKit::SharedMemory>, slotCount> m_slots;
+};
+
+} // namespace IPC
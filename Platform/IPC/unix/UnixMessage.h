@@ -30,6 +30,10 @@
 #include "Attachment.h"
 #include <wtf/Vector.h>
 
+#if OS(LINUX)
+#include <sys/socket.h>
+#endif
+
 namespace IPC {
 
 class MessageInfo {
@@ -50,14 +54,34 @@ public:
         m_attachmentCount++;
     }
 
+    void setBodyInSharedSlot(unsigned slot, bool hasSlotMemoryAttachment)
+    {
+        ASSERT(!isBodyOutOfLine());
+
+        m_isBodyOutOfLine = true;
+        m_bodySlot = slot;
+        if (hasSlotMemoryAttachment) {
+            m_hasSlotMemoryAttachment = true;
+            m_attachmentCount++;
+        }
+    }
+
     bool isBodyOutOfLine() const { return m_isBodyOutOfLine; }
+    bool isBodyInSharedSlot() const { return m_bodySlot != noBodySlot; }
+    unsigned bodySlot() const { return m_bodySlot; }
+    // Whether the last attachment is the memory holding the body.
+    bool hasBodyAttachment() const { return m_isBodyOutOfLine && (!isBodyInSharedSlot() || m_hasSlotMemoryAttachment); }
     size_t bodySize() const { return m_bodySize; }
     size_t attachmentCount() const { return m_attachmentCount; }
 
 private:
+    static const unsigned noBodySlot = std::numeric_limits<unsigned>::max();
+
     size_t m_bodySize { 0 };
     size_t m_attachmentCount { 0 };
+    unsigned m_bodySlot { noBodySlot };
     bool m_isBodyOutOfLine { false };
+    bool m_hasSlotMemoryAttachment { false };
 };
 
 class UnixMessage {
@@ -110,4 +134,54 @@ private:
     bool m_bodyOwned { false };
 };
 
+#if OS(LINUX)
+// Storage for receiving several packets with a single recvmmsg() call. A connection keeps one for all of its
+// reads, and the packets are processed where they were received.
+class UnixMessageBatch {
+    WTF_MAKE_NONCOPYABLE(UnixMessageBatch);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    UnixMessageBatch(size_t packetCount, size_t packetSize, size_t controlSize)
+        : m_packetSize(packetSize)
+        , m_controlSize(controlSize)
+        , m_packets(packetCount * packetSize)
+        , m_control(packetCount * controlSize)
+        , m_iov(packetCount)
+        , m_headers(packetCount)
+    {
+        for (size_t i = 0; i < packetCount; ++i) {
+            m_iov[i].iov_base = m_packets.data() + i * m_packetSize;
+            m_iov[i].iov_len = m_packetSize;
+            memset(&m_headers[i], 0, sizeof(struct mmsghdr));
+            m_headers[i].msg_hdr.msg_iov = &m_iov[i];
+            m_headers[i].msg_hdr.msg_iovlen = 1;
+            m_headers[i].msg_hdr.msg_control = m_control.data() + i * m_controlSize;
+        }
+    }
+
+    size_t packetCount() const { return m_headers.size(); }
+    struct mmsghdr* headers() { return m_headers.data(); }
+    struct mmsghdr& header(size_t index) { return m_headers[index]; }
+    const uint8_t* packet(size_t index) const { return m_packets.data() + index * m_packetSize; }
+
+    // recvmmsg() overwrites the lengths and flags of the headers it fills.
+    void reset()
+    {
+        for (auto& header : m_headers) {
+            header.msg_len = 0;
+            header.msg_hdr.msg_controllen = m_controlSize;
+            header.msg_hdr.msg_flags = 0;
+        }
+    }
+
+private:
+    size_t m_packetSize;
+    size_t m_controlSize;
+    Vector<uint8_t> m_packets;
+    Vector<uint8_t> m_control;
+    Vector<struct iovec> m_iov;
+    Vector<struct mmsghdr> m_headers;
+};
+#endif
+
 } // namespace IPC
@@ -420,6 +420,7 @@ list(APPEND WebKit_SYSTEM_INCLUDE_DIRECTORIES
     ${GSTREAMER_PBUTILS_INCLUDE_DIRS}
     ${HARFBUZZ_INCLUDE_DIRS}
     ${LIBSOUP_INCLUDE_DIRS}
+    ${ZLIB_INCLUDE_DIRS}
 )
 
 if (USE_LIBNOTIFY)
@@ -457,6 +458,7 @@ list(APPEND WebKit_LIBRARIES
     PRIVATE
         WebCorePlatformGTK
         ${GTK_UNIX_PRINT_LIBRARIES}
+        ${ZLIB_LIBRARIES}
 )
 
 # WebCore should be specifed before and after WebCorePlatformGTK
@@ -573,6 +575,7 @@ if (ENABLE_PLUGIN_PROCESS_GTK2)
         Platform/IPC/glib/GSocketMonitor.cpp
         Platform/IPC/unix/AttachmentUnix.cpp
         Platform/IPC/unix/ConnectionUnix.cpp
+        Platform/IPC/unix/SharedMessageBodyPool.cpp
 
         Platform/glib/ModuleGlib.cpp
 
@@ -281,6 +281,7 @@ list(APPEND WebKit_SYSTEM_INCLUDE_DIRECTORIES
     ${HARFBUZZ_INCLUDE_DIRS}
     ${LIBSOUP_INCLUDE_DIRS}
     ${WPE_INCLUDE_DIRS}
+    ${ZLIB_INCLUDE_DIRS}
 )
 
 list(APPEND WebKit_LIBRARIES
@@ -292,6 +293,7 @@ list(APPEND WebKit_LIBRARIES
         ${HARFBUZZ_LIBRARIES}
         ${LIBSOUP_LIBRARIES}
         ${WPE_LIBRARIES}
+        ${ZLIB_LIBRARIES}
 )
 
 WEBKIT_BUILD_INSPECTOR_GRESOURCES(${DERIVED_SOURCES_WEBINSPECTORUI_DIR})
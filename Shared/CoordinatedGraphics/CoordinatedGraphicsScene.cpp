@@ -35,6 +35,10 @@
 namespace WebKit {
 using namespace WebCore;
 
+// Where WEBKIT_SHOW_DAMAGE draws the composited area percentage, large enough for TextureMapperGL::drawNumber()
+// to render three digits.
+static const IntRect damageCounterRect { 0, 0, 40, 16 };
+
 static bool layerShouldHaveBackingStore(TextureMapperLayer* layer)
 {
     return layer->drawsContent() && layer->contentsAreVisible() && !layer->size().isEmpty();
@@ -42,6 +46,8 @@ static bool layerShouldHaveBackingStore(TextureMapperLayer* layer)
 
 CoordinatedGraphicsScene::CoordinatedGraphicsScene(CoordinatedGraphicsSceneClient* client)
     : m_client(client)
+    , m_showsFPSCounter(!!getenv("WEBKIT_SHOW_FPS"))
+    , m_showsDamage(!!getenv("WEBKIT_SHOW_DAMAGE"))
 {
 }
 
@@ -90,14 +96,170 @@ void CoordinatedGraphicsScene::paintToCurrentGLContext(const TransformationMatri
     }
 
     currentRootLayer->paint();
+
+    m_damageStatistics.frameCount++;
+    m_damageStatistics.compositedArea += static_cast<uint64_t>(clipRect.width() * clipRect.height());
+    if (m_showsDamage) {
+        m_textureMapper->drawBorder(Color(255, 0, 0), 2, m_lastDamageRect, TransformationMatrix());
+        if (m_damageStatistics.viewportArea)
+            m_textureMapper->drawNumber(static_cast<int>(100 * m_damageStatistics.compositedArea / m_damageStatistics.viewportArea), Color::black, damageCounterRect.location(), TransformationMatrix());
+    }
+
     m_fpsCounter.updateFPSAndDisplay(*m_textureMapper, clipRect.location(), matrix);
     m_textureMapper->endClip();
     m_textureMapper->endPainting();
 
+    m_hasRunningAnimations = sceneHasRunningAnimations;
     if (sceneHasRunningAnimations)
         updateViewport();
 }
 
+IntRect CoordinatedGraphicsScene::takeDamage(const TransformationMatrix& matrix, const IntRect& viewportRect)
+{
+    TextureMapperLayer* currentRootLayer = rootLayer();
+
+    // Animations are applied while painting, and the FPS counter is drawn at the origin of the painted area,
+    // so both need the whole viewport. So does a change of the viewport transform, as the damage is accumulated
+    // with the transform of the previous frame.
+    bool isFullyDamaged = m_isFullyDamaged || m_hasRunningAnimations || m_showsFPSCounter
+        || !currentRootLayer || currentRootLayer->transform() != matrix;
+#if USE(COORDINATED_GRAPHICS_THREADED)
+    // Platform layers swap their buffers right before painting.
+    isFullyDamaged |= !m_platformLayerProxies.isEmpty();
+#endif
+
+    IntRect damageRect = viewportRect;
+    if (!isFullyDamaged)
+        damageRect.intersect(enclosingIntRect(m_damageRect));
+
+    m_isFullyDamaged = false;
+    m_damageRect = FloatRect();
+
+    m_damageStatistics.viewportArea += static_cast<uint64_t>(viewportRect.width()) * viewportRect.height();
+    m_damageStatistics.damagedArea += static_cast<uint64_t>(damageRect.width()) * damageRect.height();
+
+    IntRect previousDamageRect = std::exchange(m_lastDamageRect, damageRect);
+    if (m_showsDamage) {
+        // The damage overlay has to be part of the frame damage too: the counter is redrawn every frame,
+        // and the border drawn around the previous damage has to be erased.
+        damageRect.unite(previousDamageRect);
+        damageRect.unite(intersection(damageCounterRect, viewportRect));
+    }
+
+    return damageRect;
+}
+
+std::optional<FloatRect> CoordinatedGraphicsScene::layerRectInViewport(CoordinatedLayerID layerID, const FloatRect& rect) const
+{
+    if (!m_rootLayer)
+        return std::nullopt;
+
+    Vector<const LayerGeometry*, 16> ancestors;
+    for (CoordinatedLayerID id = layerID; ; ) {
+        auto it = m_layerGeometries.find(id);
+        if (it == m_layerGeometries.end() || !it->value.canMapDamage())
+            return std::nullopt;
+
+        ancestors.append(&it->value);
+        if (id == m_rootLayerID)
+            break;
+
+        // Masks and replicas are not attached to the tree, they are painted through another layer.
+        if (it->value.parentID == InvalidCoordinatedLayerID || ancestors.size() > m_layerGeometries.size())
+            return std::nullopt;
+        id = it->value.parentID;
+    }
+
+    // Same as GraphicsLayerTransform, restricted to affine transforms and no children transform.
+    TransformationMatrix matrix = m_rootLayer->transform();
+    for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+        const LayerGeometry& geometry = **it;
+        FloatPoint3D origin(geometry.anchorPoint.x() * geometry.size.width(), geometry.anchorPoint.y() * geometry.size.height(), geometry.anchorPoint.z());
+        matrix.translate3d(geometry.position.x() + origin.x(), geometry.position.y() + origin.y(), origin.z())
+            .multiply(geometry.transform)
+            .translate3d(-origin.x(), -origin.y(), -origin.z());
+    }
+
+    return matrix.mapRect(rect);
+}
+
+void CoordinatedGraphicsScene::addLayerDamage(CoordinatedLayerID id, const FloatRect& rect)
+{
+    if (m_isFullyDamaged || rect.isEmpty())
+        return;
+
+    auto viewportRect = layerRectInViewport(id, rect);
+    if (!viewportRect) {
+        m_isFullyDamaged = true;
+        return;
+    }
+
+    m_damageRect.unite(*viewportRect);
+}
+
+void CoordinatedGraphicsScene::addImageBackingDamage(CoordinatedImageBackingID imageID)
+{
+    for (auto& it : m_layerGeometries) {
+        if (it.value.imageID == imageID)
+            addLayerDamage(it.key, it.value.contentsRect);
+    }
+}
+
+void CoordinatedGraphicsScene::updateLayerDamage(CoordinatedLayerID id, const CoordinatedGraphicsLayerState& state)
+{
+    if (state.childrenChanged) {
+        for (auto& child : state.children)
+            m_layerGeometries.add(child, LayerGeometry()).iterator->value.parentID = id;
+    }
+
+    LayerGeometry& geometry = m_layerGeometries.add(id, LayerGeometry()).iterator->value;
+
+    if (state.positionChanged)
+        geometry.position = state.pos;
+    if (state.anchorPointChanged)
+        geometry.anchorPoint = state.anchorPoint;
+    if (state.sizeChanged)
+        geometry.size = state.size;
+    if (state.transformChanged)
+        geometry.transform = state.transform;
+    if (state.childrenTransformChanged)
+        geometry.hasChildrenTransform = !state.childrenTransform.isIdentity();
+    if (state.contentsRectChanged)
+        geometry.contentsRect = state.contentsRect;
+    if (state.imageChanged)
+        geometry.imageID = state.imageID;
+    if (state.replicaChanged)
+        geometry.hasReplica = state.replica != InvalidCoordinatedLayerID;
+    if (state.filtersChanged)
+        geometry.hasFilters = !!state.filters.size();
+    if (state.animationsChanged)
+        geometry.hasAnimations = true;
+    for (auto& tile : state.tilesToCreate)
+        geometry.tileScale = tile.scale;
+
+    // Anything that moves or restyles layers, or changes the tree, can expose content anywhere.
+    if (state.positionChanged || state.anchorPointChanged || state.sizeChanged || state.transformChanged
+        || state.childrenTransformChanged || state.contentsRectChanged || state.contentsTilingChanged
+        || state.opacityChanged || state.debugVisualsChanged || state.replicaChanged || state.maskChanged
+        || state.imageChanged || state.flagsChanged || state.childrenChanged || state.filtersChanged
+        || state.animationsChanged || state.platformLayerChanged || !state.tilesToRemove.isEmpty()) {
+        m_isFullyDamaged = true;
+        return;
+    }
+
+    FloatRect layerRect(FloatPoint(), geometry.size);
+    if (state.solidColorChanged)
+        addLayerDamage(id, unionRect(layerRect, geometry.contentsRect));
+    if (state.repaintCountChanged)
+        addLayerDamage(id, layerRect);
+
+    for (auto& tile : state.tilesToUpdate) {
+        FloatRect tileRect(tile.tileRect);
+        tileRect.scale(1 / geometry.tileScale);
+        addLayerDamage(id, tileRect);
+    }
+}
+
 void CoordinatedGraphicsScene::updateViewport()
 {
     if (m_client)
@@ -162,6 +324,8 @@ void CoordinatedGraphicsScene::setLayerState(CoordinatedLayerID id, const Coordi
     ASSERT(m_rootLayerID != InvalidCoordinatedLayerID);
     TextureMapperLayer* layer = layerByID(id);
 
+    updateLayerDamage(id, layerState);
+
     if (layerState.positionChanged)
         layer->setPosition(layerState.pos);
 
@@ -255,6 +419,8 @@ void CoordinatedGraphicsScene::deleteLayer(CoordinatedLayerID layerID)
     std::unique_ptr<TextureMapperLayer> layer = m_layers.take(layerID);
     ASSERT(layer);
 
+    m_layerGeometries.remove(layerID);
+
     m_backingStores.remove(layer.get());
 #if USE(COORDINATED_GRAPHICS_THREADED)
     if (auto platformLayerProxy = m_platformLayerProxies.take(layer.get()))
@@ -433,6 +599,9 @@ void CoordinatedGraphicsScene::commitSceneState(const CoordinatedGraphicsState&
 
     CommitScope commitScope;
 
+    if (!state.layersToRemove.isEmpty() || state.rootCompositingLayer != m_rootLayerID || !state.imagesToRemove.isEmpty())
+        m_isFullyDamaged = true;
+
     createLayers(state.layersToCreate);
     deleteLayers(state.layersToRemove);
 
@@ -444,6 +613,12 @@ void CoordinatedGraphicsScene::commitSceneState(const CoordinatedGraphicsState&
     for (auto& layer : state.layersToUpdate)
         setLayerState(layer.first, layer.second, commitScope);
 
+    // Image damage depends on the contents rect of the layers using the image, so it's added once they are updated.
+    for (auto& image : state.imagesToUpdate)
+        addImageBackingDamage(image.first);
+    for (auto& image : state.imagesToClear)
+        addImageBackingDamage(image);
+
     for (auto& backingStore : commitScope.backingStoresWithPendingBuffers)
         backingStore->commitTileOperations(*m_textureMapper);
 }
@@ -479,6 +654,8 @@ void CoordinatedGraphicsScene::purgeGLResources()
     m_rootLayer = nullptr;
     m_rootLayerID = InvalidCoordinatedLayerID;
     m_layers.clear();
+    m_layerGeometries.clear();
+    m_isFullyDamaged = true;
     m_textureMapper = nullptr;
     m_backingStores.clear();
 }
@@ -33,6 +33,7 @@
 #include <WebCore/TextureMapperFPSCounter.h>
 #include <WebCore/TextureMapperLayer.h>
 #include <WebCore/Timer.h>
+#include <WebCore/TransformationMatrix.h>
 #include <wtf/Function.h>
 #include <wtf/HashSet.h>
 #include <wtf/Lock.h>
@@ -87,7 +88,39 @@ public:
     void setViewBackgroundColor(const WebCore::Color& color) { m_viewBackgroundColor = color; }
     WebCore::Color viewBackgroundColor() const { return m_viewBackgroundColor; }
 
+    // Damage is accumulated in viewport coordinates while state changes are applied. The compositor
+    // takes it once per frame, before painting, to limit composition to the part of the viewport that changed.
+    WebCore::IntRect takeDamage(const WebCore::TransformationMatrix&, const WebCore::IntRect& viewportRect);
+    void setFullyDamaged() { m_isFullyDamaged = true; }
+
+    struct DamageStatistics {
+        uint64_t frameCount { 0 };
+        uint64_t viewportArea { 0 };
+        uint64_t damagedArea { 0 };
+        uint64_t compositedArea { 0 };
+    };
+    const DamageStatistics& damageStatistics() const { return m_damageStatistics; }
+
 private:
+    // Mirror of the layer state needed to map layer content updates to the viewport.
+    struct LayerGeometry {
+        bool canMapDamage() const { return transform.isAffine() && !hasChildrenTransform && !hasFilters && !hasReplica && !hasAnimations; }
+
+        WebCore::CoordinatedLayerID parentID { WebCore::InvalidCoordinatedLayerID };
+        WebCore::FloatPoint position;
+        WebCore::FloatPoint3D anchorPoint { 0.5, 0.5, 0 };
+        WebCore::FloatSize size;
+        WebCore::TransformationMatrix transform;
+        WebCore::FloatRect contentsRect;
+        WebCore::CoordinatedImageBackingID imageID { WebCore::InvalidCoordinatedImageBackingID };
+        float tileScale { 1 };
+        bool hasChildrenTransform { false };
+        bool hasFilters { false };
+        bool hasReplica { false };
+        // Animated values are not mirrored, so a layer that ever had animations can't be mapped.
+        bool hasAnimations { false };
+    };
+
     struct CommitScope {
         CommitScope() = default;
         CommitScope(CommitScope&) = delete;
@@ -110,6 +143,11 @@ private:
     void syncPlatformLayerIfNeeded(WebCore::TextureMapperLayer*, const WebCore::CoordinatedGraphicsLayerState&);
     void setLayerRepaintCountIfNeeded(WebCore::TextureMapperLayer*, const WebCore::CoordinatedGraphicsLayerState&);
 
+    void updateLayerDamage(WebCore::CoordinatedLayerID, const WebCore::CoordinatedGraphicsLayerState&);
+    void addLayerDamage(WebCore::CoordinatedLayerID, const WebCore::FloatRect&);
+    void addImageBackingDamage(WebCore::CoordinatedImageBackingID);
+    std::optional<WebCore::FloatRect> layerRectInViewport(WebCore::CoordinatedLayerID, const WebCore::FloatRect&) const;
+
     void syncImageBackings(const WebCore::CoordinatedGraphicsState&, CommitScope&);
     void createImageBacking(WebCore::CoordinatedImageBackingID);
     void updateImageBacking(WebCore::CoordinatedImageBackingID, RefPtr<Nicosia::Buffer>&&, CommitScope&);
@@ -162,6 +200,15 @@ private:
     WebCore::Color m_viewBackgroundColor { WebCore::Color::white };
 
     WebCore::TextureMapperFPSCounter m_fpsCounter;
+
+    HashMap<WebCore::CoordinatedLayerID, LayerGeometry> m_layerGeometries;
+    WebCore::FloatRect m_damageRect;
+    WebCore::IntRect m_lastDamageRect;
+    bool m_isFullyDamaged { true };
+    bool m_hasRunningAnimations { false };
+    bool m_showsFPSCounter { false };
+    bool m_showsDamage { false };
+    DamageStatistics m_damageStatistics;
 };
 
 } // namespace WebKit
@@ -32,6 +32,7 @@
 #include "ThreadedDisplayRefreshMonitor.h"
 #include <WebCore/PlatformDisplay.h>
 #include <WebCore/TransformationMatrix.h>
+#include <mutex>
 #include <wtf/SetForScope.h>
 
 #if USE(LIBEPOXY)
@@ -42,9 +43,65 @@
 #include <GL/gl.h>
 #endif
 
+#if USE(EGL)
+#if USE(LIBEPOXY)
+#include <epoxy/egl.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#endif
+
 namespace WebKit {
 using namespace WebCore;
 
+static const unsigned maximumDamageHistorySize = 4;
+
+#if USE(EGL)
+#if !defined(EGL_BUFFER_AGE_EXT)
+#define EGL_BUFFER_AGE_EXT 0x313D
+#endif
+
+// EGL_KHR_partial_update and EGL_KHR/EXT_swap_buffers_with_damage entry points share this signature.
+typedef EGLBoolean (*PFNEGLDAMAGERECTSPROC) (EGLDisplay, EGLSurface, EGLint* rects, EGLint nRects);
+
+struct EGLDamageExtensions {
+    bool supportsBufferAge { false };
+    PFNEGLDAMAGERECTSPROC setDamageRegion { nullptr };
+    PFNEGLDAMAGERECTSPROC swapBuffersWithDamage { nullptr };
+};
+
+// Must be called with an EGL context current for the compositing display.
+static const EGLDamageExtensions& eglDamageExtensions()
+{
+    static EGLDamageExtensions damageExtensions;
+    static std::once_flag onceFlag;
+    std::call_once(onceFlag, [] {
+        const char* extensions = eglQueryString(eglGetCurrentDisplay(), EGL_EXTENSIONS);
+        if (GLContext::isExtensionSupported(extensions, "EGL_KHR_partial_update")) {
+            damageExtensions.supportsBufferAge = true;
+            damageExtensions.setDamageRegion = reinterpret_cast<PFNEGLDAMAGERECTSPROC>(eglGetProcAddress("eglSetDamageRegionKHR"));
+        } else if (GLContext::isExtensionSupported(extensions, "EGL_EXT_buffer_age"))
+            damageExtensions.supportsBufferAge = true;
+
+        if (GLContext::isExtensionSupported(extensions, "EGL_KHR_swap_buffers_with_damage"))
+            damageExtensions.swapBuffersWithDamage = reinterpret_cast<PFNEGLDAMAGERECTSPROC>(eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+        else if (GLContext::isExtensionSupported(extensions, "EGL_EXT_swap_buffers_with_damage"))
+            damageExtensions.swapBuffersWithDamage = reinterpret_cast<PFNEGLDAMAGERECTSPROC>(eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+    });
+    return damageExtensions;
+}
+
+static void toEGLRect(const IntRect& rect, const IntRect& viewportRect, EGLint eglRect[4])
+{
+    // EGL rectangles have their origin at the bottom left corner of the surface.
+    eglRect[0] = rect.x();
+    eglRect[1] = viewportRect.height() - rect.maxY();
+    eglRect[2] = rect.width();
+    eglRect[3] = rect.height();
+}
+#endif
+
 Ref<ThreadedCompositor> ThreadedCompositor::create(Client& client, PlatformDisplayID displayID, const IntSize& viewportSize, float scaleFactor, ShouldDoFrameSync doFrameSync, TextureMapper::PaintFlags paintFlags)
 {
     return adoptRef(*new ThreadedCompositor(client, displayID, viewportSize, scaleFactor, doFrameSync, paintFlags));
@@ -96,6 +153,69 @@ void ThreadedCompositor::createGLContext()
 
     if (m_doFrameSync == ShouldDoFrameSync::No)
         m_context->swapInterval(0);
+
+    m_damageHistory.clear();
+    m_scene->setFullyDamaged();
+}
+
+IntRect ThreadedCompositor::repaintRectForDamage(const IntRect& damageRect, const IntRect& viewportRect)
+{
+    // Without a known buffer age the contents of the back buffer are undefined and have to be fully repainted.
+    unsigned bufferAge = 0;
+#if USE(EGL)
+    if (m_context->isEGLContext() && eglDamageExtensions().supportsBufferAge) {
+        EGLint age = 0;
+        if (eglQuerySurface(eglGetCurrentDisplay(), eglGetCurrentSurface(EGL_DRAW), EGL_BUFFER_AGE_EXT, &age) && age > 0)
+            bufferAge = age;
+    }
+#endif
+
+    IntRect repaintRect = viewportRect;
+    if (bufferAge && bufferAge <= m_damageHistory.size() + 1) {
+        repaintRect = damageRect;
+        unsigned framesSinceBufferWasPainted = bufferAge - 1;
+        for (auto& rect : m_damageHistory) {
+            if (!framesSinceBufferWasPainted--)
+                break;
+            repaintRect.unite(rect);
+        }
+    }
+
+    m_damageHistory.prepend(damageRect);
+    if (m_damageHistory.size() > maximumDamageHistorySize)
+        m_damageHistory.removeLast();
+
+    // Nothing changed since the back buffer was painted, but we still render and swap a frame. Without a damage
+    // region the whole buffer counts as redrawn, so redraw all of it rather than leave it undefined.
+    if (repaintRect.isEmpty())
+        repaintRect = viewportRect;
+
+#if USE(EGL)
+    if (repaintRect != viewportRect && !repaintRect.isEmpty() && eglDamageExtensions().setDamageRegion) {
+        EGLint eglRect[4];
+        toEGLRect(repaintRect, viewportRect, eglRect);
+        eglDamageExtensions().setDamageRegion(eglGetCurrentDisplay(), eglGetCurrentSurface(EGL_DRAW), eglRect, 1);
+    }
+#endif
+
+    return repaintRect;
+}
+
+void ThreadedCompositor::swapBuffers(const IntRect& damageRect, const IntRect& viewportRect)
+{
+#if USE(EGL)
+    if (damageRect != viewportRect && !damageRect.isEmpty() && m_context->isEGLContext() && eglDamageExtensions().swapBuffersWithDamage) {
+        EGLint eglRect[4];
+        toEGLRect(damageRect, viewportRect, eglRect);
+        if (eglDamageExtensions().swapBuffersWithDamage(eglGetCurrentDisplay(), eglGetCurrentSurface(EGL_DRAW), eglRect, 1))
+            return;
+    }
+#else
+    UNUSED_PARAM(damageRect);
+    UNUSED_PARAM(viewportRect);
+#endif
+
+    m_context->swapBuffers();
 }
 
 void ThreadedCompositor::invalidate()
@@ -160,6 +280,7 @@ void ThreadedCompositor::setDrawsBackground(bool drawsBackground)
 {
     LockHolder locker(m_attributes.lock);
     m_attributes.drawsBackground = drawsBackground;
+    m_attributes.needsFullRepaint = true;
     m_compositingRunLoop->scheduleUpdate();
 }
 
@@ -196,6 +317,7 @@ void ThreadedCompositor::renderLayerTree()
     float scaleFactor;
     bool drawsBackground;
     bool needsResize;
+    bool needsFullRepaint;
     Vector<WebCore::CoordinatedGraphicsState> states;
 
     {
@@ -205,6 +327,7 @@ void ThreadedCompositor::renderLayerTree()
         scaleFactor = m_attributes.scaleFactor;
         drawsBackground = m_attributes.drawsBackground;
         needsResize = m_attributes.needsResize;
+        needsFullRepaint = m_attributes.needsFullRepaint;
 
         states = WTFMove(m_attributes.states);
 
@@ -224,27 +347,38 @@ void ThreadedCompositor::renderLayerTree()
             }
         }
 
-        // Reset the needsResize attribute to false.
+        // Reset the needsResize and needsFullRepaint attributes to false.
         m_attributes.needsResize = false;
+        m_attributes.needsFullRepaint = false;
     }
 
     if (needsResize)
         glViewport(0, 0, viewportSize.width(), viewportSize.height());
 
+    if (needsResize || needsFullRepaint || m_inForceRepaint)
+        m_scene->setFullyDamaged();
+
     TransformationMatrix viewportTransform;
     viewportTransform.scale(scaleFactor);
     viewportTransform.translate(-scrollPosition.x(), -scrollPosition.y());
 
+    m_scene->applyStateChanges(states);
+
+    IntRect viewportRect { IntPoint { }, viewportSize };
+    IntRect damageRect = m_scene->takeDamage(viewportTransform, viewportRect);
+    IntRect repaintRect = repaintRectForDamage(damageRect, viewportRect);
+
     if (!drawsBackground) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(repaintRect.x(), viewportSize.height() - repaintRect.maxY(), repaintRect.width(), repaintRect.height());
         glClearColor(0, 0, 0, 0);
         glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
     }
 
-    m_scene->applyStateChanges(states);
-    m_scene->paintToCurrentGLContext(viewportTransform, 1, FloatRect { FloatPoint { }, viewportSize },
-        Color::transparent, !drawsBackground, m_paintFlags);
+    m_scene->paintToCurrentGLContext(viewportTransform, 1, repaintRect, Color::transparent, !drawsBackground, m_paintFlags);
 
-    m_context->swapBuffers();
+    swapBuffers(damageRect, viewportRect);
 
     if (m_scene->isActive())
         m_client.didRenderFrame();
@@ -34,6 +34,7 @@
 #include <WebCore/IntSize.h>
 #include <WebCore/TextureMapper.h>
 #include <wtf/Atomics.h>
+#include <wtf/Deque.h>
 #include <wtf/FastMalloc.h>
 #include <wtf/Noncopyable.h>
 #include <wtf/ThreadSafeRefCounted.h>
@@ -99,6 +100,9 @@ private:
 
     void createGLContext();
 
+    WebCore::IntRect repaintRectForDamage(const WebCore::IntRect& damageRect, const WebCore::IntRect& viewportRect);
+    void swapBuffers(const WebCore::IntRect& damageRect, const WebCore::IntRect& viewportRect);
+
     Client& m_client;
     RefPtr<CoordinatedGraphicsScene> m_scene;
     std::unique_ptr<WebCore::GLContext> m_context;
@@ -108,6 +112,9 @@ private:
     WebCore::TextureMapper::PaintFlags m_paintFlags { 0 };
     bool m_inForceRepaint { false };
 
+    // Damage of the most recent frames, newest first, used to repaint buffers older than the previous frame.
+    Deque<WebCore::IntRect> m_damageHistory;
+
     std::unique_ptr<CompositingRunLoop> m_compositingRunLoop;
 
     struct {
@@ -117,6 +124,7 @@ private:
         float scaleFactor { 1 };
         bool drawsBackground { true };
         bool needsResize { false };
+        bool needsFullRepaint { false };
 
         Vector<WebCore::CoordinatedGraphicsState> states;
 
@@ -41,6 +41,7 @@ void UpdateInfo::encode(IPC::Encoder& encoder) const
     encoder << updateScaleFactor;
     encoder << bitmapHandle;
     encoder << bitmapOffset;
+    encoder << frameBufferSlot;
 }
 
 bool UpdateInfo::decode(IPC::Decoder& decoder, UpdateInfo& result)
@@ -63,6 +64,10 @@ bool UpdateInfo::decode(IPC::Decoder& decoder, UpdateInfo& result)
         return false;
     if (!decoder.decode(result.bitmapOffset))
         return false;
+    if (!decoder.decode(result.frameBufferSlot))
+        return false;
+    if (result.frameBufferSlot && *result.frameBufferSlot >= maximumFrameBufferCount)
+        return false;
 
     return true;
 }
@@ -29,6 +29,7 @@
 #include "ShareableBitmap.h"
 #include <WebCore/IntRect.h>
 #include <wtf/Noncopyable.h>
+#include <wtf/Optional.h>
 #include <wtf/Vector.h>
 
 namespace IPC {
@@ -69,6 +70,13 @@ public:
 
     // The offset in the bitmap where the rendered contents are.
     WebCore::IntPoint bitmapOffset;
+
+    // The recycled frame buffer the bitmap was painted into, if any. The bitmap handle is only sent
+    // the first time a frame buffer is used; after that the UI process finds the bitmap by its slot.
+    std::optional<uint32_t> frameBufferSlot;
+
+    // The maximum number of frame buffers a drawing area recycles.
+    static constexpr uint32_t maximumFrameBufferCount = 3;
 };
 
 } // namespace WebKit
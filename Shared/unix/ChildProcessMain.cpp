@@ -29,6 +29,15 @@
 #include <WebCore/Process.h>
 #include <stdlib.h>
 
+#if OS(LINUX)
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 namespace WebKit {
 
 bool ChildProcessMainBase::parseCommandLine(int argc, char** argv)
@@ -42,4 +51,130 @@ bool ChildProcessMainBase::parseCommandLine(int argc, char** argv)
     return true;
 }
 
+#if OS(LINUX)
+static void closeFileDescriptors(const int* fileDescriptors, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        close(fileDescriptors[i]);
+}
+
+static bool receiveForkRequest(int controlSocket, char* buffer, size_t& requestSize, int* fileDescriptors, unsigned& fileDescriptorCount)
+{
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * ForkServer::maximumFileDescriptorCount)];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = { buffer, ForkServer::maximumRequestSize };
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t bytesReceived;
+    do {
+        bytesReceived = recvmsg(controlSocket, &message, 0);
+    } while (bytesReceived == -1 && errno == EINTR);
+    // The UI process went away.
+    if (bytesReceived <= 0)
+        return false;
+
+    requestSize = bytesReceived;
+    fileDescriptorCount = 0;
+    for (auto* controlMessage = CMSG_FIRSTHDR(&message); controlMessage; controlMessage = CMSG_NXTHDR(&message, controlMessage)) {
+        if (controlMessage->cmsg_level != SOL_SOCKET || controlMessage->cmsg_type != SCM_RIGHTS)
+            continue;
+        unsigned count = (controlMessage->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        memcpy(fileDescriptors, CMSG_DATA(controlMessage), sizeof(int) * count);
+        fileDescriptorCount = count;
+    }
+
+    if (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        closeFileDescriptors(fileDescriptors, fileDescriptorCount);
+        fileDescriptorCount = 0;
+        requestSize = 0;
+    }
+    return true;
+}
+
+static char** parseForkRequest(char* buffer, size_t requestSize, const int* fileDescriptors, unsigned fileDescriptorCount, int& argc)
+{
+    if (requestSize < sizeof(ForkServer::RequestHeader))
+        return nullptr;
+
+    ForkServer::RequestHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    if (!header.argumentCount || header.argumentCount > ForkServer::maximumArgumentCount)
+        return nullptr;
+    if (static_cast<unsigned>(__builtin_popcount(header.fileDescriptorArgumentMask)) != fileDescriptorCount || header.fileDescriptorArgumentMask >> header.argumentCount)
+        return nullptr;
+
+    char* argumentStart[ForkServer::maximumArgumentCount];
+    char* argument = buffer + sizeof(header);
+    char* end = buffer + requestSize;
+    for (unsigned i = 0; i < header.argumentCount; ++i) {
+        auto* terminator = static_cast<char*>(memchr(argument, '\0', end - argument));
+        if (!terminator)
+            return nullptr;
+        argumentStart[i] = argument;
+        argument = terminator + 1;
+    }
+
+    // The command line must stay alive for the whole life of the child.
+    char** arguments = static_cast<char**>(calloc(header.argumentCount + 1, sizeof(char*)));
+    unsigned fileDescriptorIndex = 0;
+    for (unsigned i = 0; i < header.argumentCount; ++i) {
+        if (header.fileDescriptorArgumentMask & (1u << i)) {
+            char fileDescriptorString[16];
+            snprintf(fileDescriptorString, sizeof(fileDescriptorString), "%d", fileDescriptors[fileDescriptorIndex++]);
+            arguments[i] = strdup(fileDescriptorString);
+        } else
+            arguments[i] = strdup(argumentStart[i]);
+    }
+
+    argc = header.argumentCount;
+    return arguments;
+}
+
+bool runForkServer(int& argc, char**& argv)
+{
+    int controlSocket = atoi(argv[2]);
+
+    // Children are not waited for here, let the kernel reap them.
+    signal(SIGCHLD, SIG_IGN);
+
+    char buffer[ForkServer::maximumRequestSize];
+    int fileDescriptors[ForkServer::maximumFileDescriptorCount];
+    while (true) {
+        size_t requestSize;
+        unsigned fileDescriptorCount;
+        if (!receiveForkRequest(controlSocket, buffer, requestSize, fileDescriptors, fileDescriptorCount))
+            return false;
+
+        pid_t pid = -1;
+        int childArgc = 0;
+        if (auto** childArgv = parseForkRequest(buffer, requestSize, fileDescriptors, fileDescriptorCount, childArgc)) {
+            pid = fork();
+            if (!pid) {
+                close(controlSocket);
+                signal(SIGCHLD, SIG_DFL);
+                argc = childArgc;
+                argv = childArgv;
+                return true;
+            }
+            for (int i = 0; i < childArgc; ++i)
+                free(childArgv[i]);
+            free(childArgv);
+        }
+        closeFileDescriptors(fileDescriptors, fileDescriptorCount);
+
+        if (send(controlSocket, &pid, sizeof(pid), MSG_NOSIGNAL) != sizeof(pid))
+            return false;
+    }
+}
+#endif
+
 } // namespace WebKit
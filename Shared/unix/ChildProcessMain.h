@@ -27,6 +27,7 @@
 #define ChildProcessMain_h
 
 #include "ChildProcess.h"
+#include "ForkServer.h"
 #include "WebKit2Initialize.h"
 #include <wtf/RunLoop.h>
 
@@ -44,9 +45,21 @@ protected:
     ChildProcessInitializationParameters m_parameters;
 };
 
+#if OS(LINUX)
+// Returns only in the forked children, with argc and argv set to their command line.
+bool runForkServer(int& argc, char**& argv);
+#endif
+
 template<typename ChildProcessType, typename ChildProcessMainType>
 int ChildProcessMain(int argc, char** argv)
 {
+#if OS(LINUX)
+    // Nothing that creates threads or connects to the display can run before this point,
+    // it would not survive the fork.
+    if (ForkServer::isForkServerCommandLine(argc, argv) && !runForkServer(argc, argv))
+        return EXIT_SUCCESS;
+#endif
+
     ChildProcessMainType childMain;
 
     if (!childMain.platformInitialize())
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#if OS(LINUX)
+
+#include <cstdint>
+#include <cstring>
+
+namespace WebKit {
+namespace ForkServer {
+
+// A fork server is a child process executable started with this switch followed by the file
+// descriptor of a SOCK_SEQPACKET control socket. For every request received on that socket
+// it forks a child that continues to ChildProcessMain with the requested command line, and
+// replies with the pid of the child, or -1 on failure.
+static constexpr const char* commandLineSwitch = "--fork-server";
+
+// A request is a RequestHeader followed by argumentCount NUL terminated arguments, with
+// one file descriptor attached as SCM_RIGHTS for every bit set in fileDescriptorArgumentMask.
+// The child receives the number of its copy of the descriptor as the value of those arguments.
+struct RequestHeader {
+    uint32_t argumentCount;
+    uint32_t fileDescriptorArgumentMask;
+};
+
+static constexpr unsigned maximumArgumentCount = 16;
+static constexpr unsigned maximumFileDescriptorCount = 4;
+static constexpr size_t maximumRequestSize = 4096;
+
+inline bool isForkServerCommandLine(int argc, char** argv)
+{
+    return argc == 3 && !strcmp(argv[1], commandLineSwitch);
+}
+
+} // namespace ForkServer
+} // namespace WebKit
+
+#endif // OS(LINUX)
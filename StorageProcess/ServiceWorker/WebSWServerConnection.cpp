@@ -240,6 +240,12 @@ void WebSWServerConnection::didReceiveFetchData(FetchIdentifier fetchIdentifier,
     m_contentConnection->send(Messages::ServiceWorkerClientFetch::DidReceiveData { data, encodedDataLength }, fetchIdentifier.toUInt64());
 }
 
+void WebSWServerConnection::didReceiveFetchSharedData(FetchIdentifier fetchIdentifier, const SharedMemory::Handle& handle, uint64_t offset, uint64_t size, int64_t encodedDataLength)
+{
+    // Only the handle goes through this process, the data is read by the client straight from the service worker process memory.
+    m_contentConnection->send(Messages::ServiceWorkerClientFetch::DidReceiveSharedData { handle, offset, size, encodedDataLength }, fetchIdentifier.toUInt64());
+}
+
 void WebSWServerConnection::didReceiveFetchFormData(FetchIdentifier fetchIdentifier, const IPC::FormDataReference& formData)
 {
     m_contentConnection->send(Messages::ServiceWorkerClientFetch::DidReceiveFormData { formData }, fetchIdentifier.toUInt64());
@@ -29,6 +29,7 @@
 
 #include "MessageReceiver.h"
 #include "MessageSender.h"
+#include "SharedMemory.h"
 #include <WebCore/FetchIdentifier.h>
 #include <WebCore/SWServer.h>
 #include <pal/SessionID.h>
@@ -63,6 +64,7 @@ public:
 
     void didReceiveFetchResponse(WebCore::FetchIdentifier, const WebCore::ResourceResponse&);
     void didReceiveFetchData(WebCore::FetchIdentifier, const IPC::DataReference&, int64_t encodedDataLength);
+    void didReceiveFetchSharedData(WebCore::FetchIdentifier, const SharedMemory::Handle&, uint64_t offset, uint64_t size, int64_t encodedDataLength);
     void didReceiveFetchFormData(WebCore::FetchIdentifier, const IPC::FormDataReference&);
     void didFinishFetch(WebCore::FetchIdentifier);
     void didFailFetch(WebCore::FetchIdentifier, const WebCore::ResourceError&);
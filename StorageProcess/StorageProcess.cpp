@@ -522,6 +522,12 @@ void StorageProcess::didReceiveFetchData(SWServerConnectionIdentifier serverConn
         connection->didReceiveFetchData(fetchIdentifier, data, encodedDataLength);
 }
 
+void StorageProcess::didReceiveFetchSharedData(SWServerConnectionIdentifier serverConnectionIdentifier, FetchIdentifier fetchIdentifier, const SharedMemory::Handle& handle, uint64_t offset, uint64_t size, int64_t encodedDataLength)
+{
+    if (auto* connection = m_swServerConnections.get(serverConnectionIdentifier))
+        connection->didReceiveFetchSharedData(fetchIdentifier, handle, offset, size, encodedDataLength);
+}
+
 void StorageProcess::didReceiveFetchFormData(SWServerConnectionIdentifier serverConnectionIdentifier, FetchIdentifier fetchIdentifier, const IPC::FormDataReference& formData)
 {
     if (auto* connection = m_swServerConnections.get(serverConnectionIdentifier))
@@ -27,6 +27,7 @@
 
 #include "ChildProcess.h"
 #include "SandboxExtension.h"
+#include "SharedMemory.h"
 #include <WebCore/FetchIdentifier.h>
 #include <WebCore/IDBBackingStore.h>
 #include <WebCore/IDBServer.h>
@@ -140,6 +141,7 @@ private:
 #if ENABLE(SERVICE_WORKER)
     void didReceiveFetchResponse(WebCore::SWServerConnectionIdentifier, WebCore::FetchIdentifier, const WebCore::ResourceResponse&);
     void didReceiveFetchData(WebCore::SWServerConnectionIdentifier, WebCore::FetchIdentifier, const IPC::DataReference&, int64_t encodedDataLength);
+    void didReceiveFetchSharedData(WebCore::SWServerConnectionIdentifier, WebCore::FetchIdentifier, const SharedMemory::Handle&, uint64_t offset, uint64_t size, int64_t encodedDataLength);
     void didReceiveFetchFormData(WebCore::SWServerConnectionIdentifier, WebCore::FetchIdentifier, const IPC::FormDataReference&);
     void didFinishFetch(WebCore::SWServerConnectionIdentifier, WebCore::FetchIdentifier);
     void didFailFetch(WebCore::SWServerConnectionIdentifier, WebCore::FetchIdentifier, const WebCore::ResourceError&);
@@ -130,6 +130,9 @@ Ref<ProcessPoolConfiguration> ProcessPoolConfiguration::copy()
     copy->m_processSwapsOnNavigation = this->m_processSwapsOnNavigation;
     copy->m_alwaysKeepAndReuseSwappedProcesses = this->m_alwaysKeepAndReuseSwappedProcesses;
     copy->m_processSwapsOnWindowOpenWithOpener = this->m_processSwapsOnWindowOpenWithOpener;
+    copy->m_minimumPrewarmedProcessCount = this->m_minimumPrewarmedProcessCount;
+    copy->m_maximumPrewarmedProcessCount = this->m_maximumPrewarmedProcessCount;
+    copy->m_prewarmedProcessIdleTimeout = this->m_prewarmedProcessIdleTimeout;
 #if ENABLE(WIFI_ASSERTIONS)
     copy->m_wirelessContextIdentifier = this->m_wirelessContextIdentifier;
 #endif
@@ -30,6 +30,7 @@
 #include "WebsiteDataStore.h"
 #include <wtf/ProcessID.h>
 #include <wtf/Ref.h>
+#include <wtf/Seconds.h>
 #include <wtf/Vector.h>
 #include <wtf/text/CString.h>
 #include <wtf/text/WTFString.h>
@@ -144,6 +145,15 @@ public:
     bool processSwapsOnWindowOpenWithOpener() const { return m_processSwapsOnWindowOpenWithOpener; }
     void setProcessSwapsOnWindowOpenWithOpener(bool swaps) { m_processSwapsOnWindowOpenWithOpener = swaps; }
 
+    unsigned minimumPrewarmedProcessCount() const { return m_minimumPrewarmedProcessCount; }
+    void setMinimumPrewarmedProcessCount(unsigned count) { m_minimumPrewarmedProcessCount = count; }
+
+    unsigned maximumPrewarmedProcessCount() const { return m_maximumPrewarmedProcessCount; }
+    void setMaximumPrewarmedProcessCount(unsigned count) { m_maximumPrewarmedProcessCount = count; }
+
+    Seconds prewarmedProcessIdleTimeout() const { return m_prewarmedProcessIdleTimeout; }
+    void setPrewarmedProcessIdleTimeout(Seconds timeout) { m_prewarmedProcessIdleTimeout = timeout; }
+
 #if ENABLE(WIFI_ASSERTIONS)
     unsigned wirelessContextIdentifier() const { return m_wirelessContextIdentifier; }
     void setWirelessContextIdentifier(unsigned wirelessContextIdentifier) { m_wirelessContextIdentifier = wirelessContextIdentifier; }
@@ -188,6 +198,9 @@ private:
     bool m_processSwapsOnNavigation { false };
     bool m_alwaysKeepAndReuseSwappedProcesses { false };
     bool m_processSwapsOnWindowOpenWithOpener { false };
+    unsigned m_minimumPrewarmedProcessCount { 1 };
+    unsigned m_maximumPrewarmedProcessCount { 1 };
+    Seconds m_prewarmedProcessIdleTimeout { 30_s };
 
 #if PLATFORM(IOS)
     WTF::String m_ctDataConnectionServiceType;
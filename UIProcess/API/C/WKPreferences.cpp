@@ -2043,3 +2043,13 @@ bool WKPreferencesGetPunchOutWhiteBackgroundsInDarkMode(WKPreferencesRef prefere
 {
     return toImpl(preferencesRef)->punchOutWhiteBackgroundsInDarkMode();
 }
+
+void WKPreferencesSetParallelPaintingEnabled(WKPreferencesRef preferencesRef, bool flag)
+{
+    toImpl(preferencesRef)->setParallelPaintingEnabled(flag);
+}
+
+bool WKPreferencesGetParallelPaintingEnabled(WKPreferencesRef preferencesRef)
+{
+    return toImpl(preferencesRef)->parallelPaintingEnabled();
+}
@@ -573,6 +573,10 @@ WK_EXPORT bool WKPreferencesGetColorFilterEnabled(WKPreferencesRef);
 WK_EXPORT void WKPreferencesSetPunchOutWhiteBackgroundsInDarkMode(WKPreferencesRef, bool flag);
 WK_EXPORT bool WKPreferencesGetPunchOutWhiteBackgroundsInDarkMode(WKPreferencesRef);
 
+// Defaults to false.
+WK_EXPORT void WKPreferencesSetParallelPaintingEnabled(WKPreferencesRef, bool flag);
+WK_EXPORT bool WKPreferencesGetParallelPaintingEnabled(WKPreferencesRef);
+
 #ifdef __cplusplus
 }
 #endif
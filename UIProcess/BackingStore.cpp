@@ -26,9 +26,6 @@
 #include "config.h"
 #include "BackingStore.h"
 
-#include "ShareableBitmap.h"
-#include "UpdateInfo.h"
-
 namespace WebKit {
 using namespace WebCore;
 
@@ -44,21 +41,4 @@ BackingStore::~BackingStore()
 {
 }
 
-void BackingStore::incorporateUpdate(const UpdateInfo& updateInfo)
-{
-    ASSERT(m_size == updateInfo.viewSize);
-    
-    RefPtr<ShareableBitmap> bitmap = ShareableBitmap::create(updateInfo.bitmapHandle);
-    if (!bitmap)
-        return;
-
-#if !ASSERT_DISABLED
-    IntSize updateSize = updateInfo.updateRectBounds.size();
-    updateSize.scale(m_deviceScaleFactor);
-    ASSERT(bitmap->size() == updateSize);
-#endif
-    
-    incorporateUpdate(bitmap.get(), updateInfo);
-}
-
 } // namespace WebKit
@@ -54,10 +54,9 @@ public:
 #endif
 
     void paint(PlatformGraphicsContext, const WebCore::IntRect&);
-    void incorporateUpdate(const UpdateInfo&);
+    void incorporateUpdate(ShareableBitmap*, const UpdateInfo&);
 
 private:
-    void incorporateUpdate(ShareableBitmap*, const UpdateInfo&);
     void scroll(const WebCore::IntRect& scrollRect, const WebCore::IntSize& scrollOffset);
 
 #if USE(CAIRO)
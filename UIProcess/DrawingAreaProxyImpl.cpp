@@ -29,6 +29,7 @@
 #include "DrawingAreaMessages.h"
 #include "DrawingAreaProxyMessages.h"
 #include "LayerTreeContext.h"
+#include "ShareableBitmap.h"
 #include "UpdateInfo.h"
 #include "WebPageGroup.h"
 #include "WebPageProxy.h"
@@ -117,6 +118,8 @@ void DrawingAreaProxyImpl::setBackingStoreIsDiscardable(bool isBackingStoreDisca
 
 void DrawingAreaProxyImpl::update(uint64_t backingStoreStateID, const UpdateInfo& updateInfo)
 {
+    updateFrameBuffers(updateInfo);
+
     ASSERT_ARG(backingStoreStateID, backingStoreStateID <= m_currentBackingStoreStateID);
     if (backingStoreStateID < m_currentBackingStoreStateID)
         return;
@@ -129,6 +132,8 @@ void DrawingAreaProxyImpl::update(uint64_t backingStoreStateID, const UpdateInfo
 
 void DrawingAreaProxyImpl::didUpdateBackingStoreState(uint64_t backingStoreStateID, const UpdateInfo& updateInfo, const LayerTreeContext& layerTreeContext)
 {
+    updateFrameBuffers(updateInfo);
+
     AcceleratedDrawingAreaProxy::didUpdateBackingStoreState(backingStoreStateID, updateInfo, layerTreeContext);
     if (isInAcceleratedCompositingMode()) {
         ASSERT(!m_backingStore);
@@ -143,6 +148,8 @@ void DrawingAreaProxyImpl::didUpdateBackingStoreState(uint64_t backingStoreState
 
 void DrawingAreaProxyImpl::exitAcceleratedCompositingMode(uint64_t backingStoreStateID, const UpdateInfo& updateInfo)
 {
+    updateFrameBuffers(updateInfo);
+
     ASSERT_ARG(backingStoreStateID, backingStoreStateID <= m_currentBackingStoreStateID);
     if (backingStoreStateID < m_currentBackingStoreStateID)
         return;
@@ -162,7 +169,8 @@ void DrawingAreaProxyImpl::incorporateUpdate(const UpdateInfo& updateInfo)
     if (!m_backingStore)
         m_backingStore = std::make_unique<BackingStore>(updateInfo.viewSize, updateInfo.deviceScaleFactor, m_webPageProxy);
 
-    m_backingStore->incorporateUpdate(updateInfo);
+    if (RefPtr<ShareableBitmap> bitmap = bitmapForUpdate(updateInfo))
+        m_backingStore->incorporateUpdate(bitmap.get(), updateInfo);
 
     Region damageRegion;
     if (updateInfo.scrollRect.isEmpty()) {
@@ -173,9 +181,43 @@ void DrawingAreaProxyImpl::incorporateUpdate(const UpdateInfo& updateInfo)
     m_webPageProxy.setViewNeedsDisplay(damageRegion);
 }
 
+void DrawingAreaProxyImpl::updateFrameBuffers(const UpdateInfo& updateInfo)
+{
+    // The web process only sends the handle of a frame buffer the first time it uses it, so keep
+    // the mapping even when the update itself turns out to be stale.
+    if (!updateInfo.frameBufferSlot || updateInfo.bitmapHandle.isNull())
+        return;
+
+    uint32_t slot = *updateInfo.frameBufferSlot;
+    if (slot >= m_frameBuffers.size())
+        m_frameBuffers.grow(slot + 1);
+
+    RefPtr<ShareableBitmap> bitmap = ShareableBitmap::create(updateInfo.bitmapHandle);
+    m_frameBuffers[slot] = bitmap ? bitmap->sharedMemory() : nullptr;
+}
+
+RefPtr<ShareableBitmap> DrawingAreaProxyImpl::bitmapForUpdate(const UpdateInfo& updateInfo)
+{
+    if (!updateInfo.frameBufferSlot)
+        return ShareableBitmap::create(updateInfo.bitmapHandle);
+
+    uint32_t slot = *updateInfo.frameBufferSlot;
+    if (slot >= m_frameBuffers.size() || !m_frameBuffers[slot])
+        return nullptr;
+
+    IntSize bitmapSize = updateInfo.updateRectBounds.size();
+    bitmapSize.scale(updateInfo.deviceScaleFactor);
+    auto numBytes = ShareableBitmap::numBytesForSize(bitmapSize, { });
+    if (numBytes.hasOverflowed() || numBytes.unsafeGet() > m_frameBuffers[slot]->size())
+        return nullptr;
+
+    return ShareableBitmap::create(bitmapSize, { }, m_frameBuffers[slot]);
+}
+
 void DrawingAreaProxyImpl::enterAcceleratedCompositingMode(const LayerTreeContext& layerTreeContext)
 {
     m_backingStore = nullptr;
+    m_frameBuffers.clear();
     AcceleratedDrawingAreaProxy::enterAcceleratedCompositingMode(layerTreeContext);
 }
 
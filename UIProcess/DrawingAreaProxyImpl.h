@@ -54,6 +54,8 @@ private:
     void exitAcceleratedCompositingMode(uint64_t backingStoreStateID, const UpdateInfo&) override;
 
     void incorporateUpdate(const UpdateInfo&);
+    void updateFrameBuffers(const UpdateInfo&);
+    RefPtr<ShareableBitmap> bitmapForUpdate(const UpdateInfo&);
 
     void enterAcceleratedCompositingMode(const LayerTreeContext&) override;
 
@@ -84,6 +86,7 @@ private:
 
     bool m_isBackingStoreDiscardable { true };
     std::unique_ptr<BackingStore> m_backingStore;
+    Vector<RefPtr<SharedMemory>> m_frameBuffers;
     RunLoop::Timer<DrawingAreaProxyImpl> m_discardBackingStoreTimer;
     std::unique_ptr<DrawingMonitor> m_drawingMonitor;
 };
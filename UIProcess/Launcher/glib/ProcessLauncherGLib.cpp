@@ -28,11 +28,14 @@
 #include "ProcessLauncher.h"
 
 #include "Connection.h"
+#include "ForkServer.h"
 #include "ProcessExecutablePath.h"
 #include <WebCore/FileSystem.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <glib.h>
+#include <poll.h>
+#include <sys/socket.h>
 #include <wtf/RunLoop.h>
 #include <wtf/UniStdExtras.h>
 #include <wtf/glib/GLibUtilities.h>
@@ -53,6 +56,171 @@ static void childSetupFunction(gpointer userData)
     close(socket);
 }
 
+#if OS(LINUX)
+// Launches children by asking an already running copy of their executable to fork,
+// so that they don't need to go through exec and dynamic linking every time.
+class ForkServerConnection {
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    static ForkServerConnection* get(ProcessLauncher::ProcessType, const CString& executablePath);
+
+    GPid launch(char** argv, uint32_t fileDescriptorArgumentMask);
+
+private:
+    explicit ForkServerConnection(int controlSocket)
+        : m_controlSocket(controlSocket)
+    {
+    }
+
+    static std::unique_ptr<ForkServerConnection> spawn(const CString& executablePath);
+
+    bool isValid() const { return m_controlSocket != -1; }
+    void invalidate();
+
+    // A fork server that doesn't answer within this time is considered hung, and the process is spawned directly.
+    static const int replyTimeoutMilliseconds = 1000;
+
+    int m_controlSocket;
+};
+
+static bool isForkServerEnabled()
+{
+    static bool enabled = !g_strcmp0(g_getenv("WEBKIT_USE_FORK_SERVER"), "1");
+    return enabled;
+}
+
+static void forkServerChildSetupFunction(gpointer userData)
+{
+    // GLib marked every descriptor close-on-exec, keep the control socket.
+    int socket = GPOINTER_TO_INT(userData);
+    int flags = fcntl(socket, F_GETFD);
+    if (flags != -1)
+        fcntl(socket, F_SETFD, flags & ~FD_CLOEXEC);
+}
+
+std::unique_ptr<ForkServerConnection> ForkServerConnection::spawn(const CString& executablePath)
+{
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == -1)
+        return nullptr;
+
+    GUniquePtr<gchar> controlSocket(g_strdup_printf("%d", sockets[1]));
+    char* argv[] = { const_cast<char*>(executablePath.data()), const_cast<char*>(ForkServer::commandLineSwitch), controlSocket.get(), nullptr };
+    GUniqueOutPtr<GError> error;
+    bool didSpawn = g_spawn_async(nullptr, argv, nullptr, G_SPAWN_DEFAULT, forkServerChildSetupFunction, GINT_TO_POINTER(sockets[1]), nullptr, &error.outPtr());
+    close(sockets[1]);
+    if (!didSpawn) {
+        g_warning("Unable to start fork server %s: %s", executablePath.data(), error->message);
+        close(sockets[0]);
+        return nullptr;
+    }
+
+    return std::unique_ptr<ForkServerConnection>(new ForkServerConnection(sockets[0]));
+}
+
+ForkServerConnection* ForkServerConnection::get(ProcessLauncher::ProcessType processType, const CString& executablePath)
+{
+    ASSERT(RunLoop::isMain());
+    if (!isForkServerEnabled())
+        return nullptr;
+
+    static std::unique_ptr<ForkServerConnection> webProcessForkServer;
+    static std::unique_ptr<ForkServerConnection> networkProcessForkServer;
+    std::unique_ptr<ForkServerConnection>* forkServer;
+    switch (processType) {
+    case ProcessLauncher::ProcessType::Web:
+        forkServer = &webProcessForkServer;
+        break;
+    case ProcessLauncher::ProcessType::Network:
+        forkServer = &networkProcessForkServer;
+        break;
+    default:
+        return nullptr;
+    }
+
+    // Start a new fork server if the previous one died.
+    if (!*forkServer || !(*forkServer)->isValid())
+        *forkServer = spawn(executablePath);
+    return forkServer->get();
+}
+
+void ForkServerConnection::invalidate()
+{
+    close(m_controlSocket);
+    m_controlSocket = -1;
+}
+
+GPid ForkServerConnection::launch(char** argv, uint32_t fileDescriptorArgumentMask)
+{
+    Vector<char, ForkServer::maximumRequestSize> request;
+    ForkServer::RequestHeader header = { 0, fileDescriptorArgumentMask };
+    request.grow(sizeof(header));
+
+    Vector<int, ForkServer::maximumFileDescriptorCount> fileDescriptors;
+    for (unsigned i = 0; argv[i]; ++i) {
+        if (fileDescriptorArgumentMask & (1u << i))
+            fileDescriptors.append(atoi(argv[i]));
+        request.append(argv[i], strlen(argv[i]) + 1);
+        ++header.argumentCount;
+    }
+    memcpy(request.data(), &header, sizeof(header));
+    if (header.argumentCount > ForkServer::maximumArgumentCount || request.size() > ForkServer::maximumRequestSize || fileDescriptors.size() > ForkServer::maximumFileDescriptorCount)
+        return 0;
+
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * ForkServer::maximumFileDescriptorCount)];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = { request.data(), request.size() };
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    if (!fileDescriptors.isEmpty()) {
+        message.msg_control = control.buffer;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fileDescriptors.size());
+        auto* controlMessage = CMSG_FIRSTHDR(&message);
+        controlMessage->cmsg_level = SOL_SOCKET;
+        controlMessage->cmsg_type = SCM_RIGHTS;
+        controlMessage->cmsg_len = CMSG_LEN(sizeof(int) * fileDescriptors.size());
+        memcpy(CMSG_DATA(controlMessage), fileDescriptors.data(), sizeof(int) * fileDescriptors.size());
+    }
+
+    if (sendmsg(m_controlSocket, &message, MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+        invalidate();
+        return 0;
+    }
+
+    struct pollfd pollDescriptor = { m_controlSocket, POLLIN, 0 };
+    int pollResult;
+    do {
+        pollResult = poll(&pollDescriptor, 1, replyTimeoutMilliseconds);
+    } while (pollResult == -1 && errno == EINTR);
+    if (pollResult <= 0) {
+        // A late reply would be read as the pid of the next launch, so stop using this fork server.
+        g_warning("Fork server did not reply in %d ms, spawning the process directly", replyTimeoutMilliseconds);
+        invalidate();
+        return 0;
+    }
+
+    pid_t pid;
+    ssize_t bytesReceived;
+    do {
+        bytesReceived = recv(m_controlSocket, &pid, sizeof(pid), MSG_DONTWAIT);
+    } while (bytesReceived == -1 && errno == EINTR);
+    if (bytesReceived != sizeof(pid)) {
+        invalidate();
+        return 0;
+    }
+    if (pid <= 0)
+        return 0;
+
+    return pid;
+}
+#endif
+
 void ProcessLauncher::launchProcess()
 {
     GPid pid = 0;
@@ -124,6 +292,7 @@ void ProcessLauncher::launchProcess()
 
     char** argv = g_newa(char*, nargs);
     unsigned i = 0;
+    uint32_t fileDescriptorArgumentMask = 0;
 #if ENABLE(DEVELOPER_MODE)
     // If there's a prefix command, put it before the rest of the args.
     for (auto& arg : prefixArgs)
@@ -131,10 +300,12 @@ void ProcessLauncher::launchProcess()
 #endif
     argv[i++] = const_cast<char*>(realExecutablePath.data());
     argv[i++] = processIdentifier.get();
+    fileDescriptorArgumentMask |= 1u << i;
     argv[i++] = webkitSocket.get();
 #if PLATFORM(WPE)
     if (m_launchOptions.processType == ProcessLauncher::ProcessType::Web) {
         argv[i++] = const_cast<char*>(wpeBackendLibraryParameter.isNull() ? "-" : wpeBackendLibraryParameter.data());
+        fileDescriptorArgumentMask |= 1u << i;
         argv[i++] = wpeSocket.get();
     }
 #endif
@@ -145,8 +316,19 @@ void ProcessLauncher::launchProcess()
 #endif
     argv[i++] = nullptr;
 
+#if OS(LINUX)
+    bool canUseForkServer = true;
+#if ENABLE(DEVELOPER_MODE)
+    canUseForkServer = prefixArgs.isEmpty();
+#endif
+    if (canUseForkServer) {
+        if (auto* forkServer = ForkServerConnection::get(m_launchOptions.processType, realExecutablePath))
+            pid = forkServer->launch(argv, fileDescriptorArgumentMask);
+    }
+#endif
+
     GUniqueOutPtr<GError> error;
-    if (!g_spawn_async(nullptr, argv, nullptr, G_SPAWN_LEAVE_DESCRIPTORS_OPEN, childSetupFunction, GINT_TO_POINTER(socketPair.server), &pid, &error.outPtr()))
+    if (!pid && !g_spawn_async(nullptr, argv, nullptr, G_SPAWN_LEAVE_DESCRIPTORS_OPEN, childSetupFunction, GINT_TO_POINTER(socketPair.server), &pid, &error.outPtr()))
         g_error("Unable to fork a new child process: %s", error->message);
 
     // Don't expose the parent socket to potential future children.
@@ -127,6 +127,7 @@ namespace WebKit {
 DEFINE_DEBUG_ONLY_GLOBAL(WTF::RefCountedLeakCounter, processPoolCounter, ("WebProcessPool"));
 
 static const Seconds serviceWorkerTerminationDelay { 5_s };
+static const Seconds prewarmedProcessDemandWindow { 10_s };
 
 static uint64_t generateListenerIdentifier()
 {
@@ -246,6 +247,7 @@ WebProcessPool::WebProcessPool(API::ProcessPoolConfiguration& configuration)
     , m_hiddenPageThrottlingAutoIncreasesCounter([this](RefCounterEvent) { m_hiddenPageThrottlingTimer.startOneShot(0_s); })
     , m_hiddenPageThrottlingTimer(RunLoop::main(), this, &WebProcessPool::updateHiddenPageThrottlingAutoIncreaseLimit)
     , m_serviceWorkerProcessesTerminationTimer(RunLoop::main(), this, &WebProcessPool::terminateServiceWorkerProcesses)
+    , m_prewarmedProcessPoolTimer(RunLoop::main(), this, &WebProcessPool::updatePrewarmedProcessPool)
 #if PLATFORM(IOS)
     , m_foregroundWebProcessCounter([this](RefCounterEvent) { updateProcessAssertions(); })
     , m_backgroundWebProcessCounter([this](RefCounterEvent) { updateProcessAssertions(); })
@@ -311,6 +313,12 @@ WebProcessPool::~WebProcessPool()
 
     removeLanguageChangeObserver(this);
 
+    if (m_prewarmedProcessStatistics.hitCount || m_prewarmedProcessStatistics.missCount) {
+        RELEASE_LOG(Process, "%p - WebProcessPool::~WebProcessPool: prewarmed processes: %llu hits, %llu misses, %llu wasted for %.1fs", this,
+            static_cast<unsigned long long>(m_prewarmedProcessStatistics.hitCount), static_cast<unsigned long long>(m_prewarmedProcessStatistics.missCount),
+            static_cast<unsigned long long>(m_prewarmedProcessStatistics.wastedProcessCount), m_prewarmedProcessStatistics.wastedPrewarmTime.seconds());
+    }
+
     m_messageReceiverMap.invalidate();
 
     for (auto& supplement : m_supplements.values()) {
@@ -429,6 +437,13 @@ void WebProcessPool::sendMemoryPressureEvent(bool isCritical)
 #if ENABLE(NETSCAPE_PLUGIN_API)
     PluginProcessManager::singleton().sendMemoryPressureEvent(isCritical);
 #endif
+
+    // This is called on the MemoryPressureMonitor thread, the prewarmed pool is only touched on the main thread.
+    RunLoop::main().dispatch([protectedThis = makeRef(*this), isCritical] {
+        // Forget the recent demand so that the pool does not immediately grow back.
+        protectedThis->m_prewarmedProcessRequestTimes.clear();
+        protectedThis->shrinkPrewarmedProcessPool(isCritical ? 0 : protectedThis->m_configuration->minimumPrewarmedProcessCount());
+    });
 }
 #endif
 
@@ -778,12 +793,27 @@ WebProcessProxy& WebProcessPool::createNewWebProcess(WebsiteDataStore& websiteDa
 
 RefPtr<WebProcessProxy> WebProcessPool::tryTakePrewarmedProcess(WebsiteDataStore& websiteDataStore)
 {
-    if (!m_prewarmedProcessCount)
+    bool prewarmingEnabled = isPrewarmingEnabled();
+    if (prewarmingEnabled) {
+        m_prewarmedProcessRequestTimes.append(MonotonicTime::now());
+        if (m_prewarmedProcessRequestTimes.size() > m_configuration->maximumPrewarmedProcessCount())
+            m_prewarmedProcessRequestTimes.removeFirst();
+
+        // Replenish right away when the pool is allowed to grow so that bursts of page creations do not each pay for a process launch.
+        if (m_configuration->maximumPrewarmedProcessCount() > 1)
+            m_prewarmedProcessPoolTimer.startOneShot(0_s);
+    }
+
+    if (!m_prewarmedProcessCount) {
+        if (prewarmingEnabled)
+            ++m_prewarmedProcessStatistics.missCount;
         return nullptr;
+    }
 
     for (const auto& process : m_processes) {
         if (process->isInPrewarmedPool()) {
             --m_prewarmedProcessCount;
+            ++m_prewarmedProcessStatistics.hitCount;
             process->setIsInPrewarmedPool(false);
             if (&process->websiteDataStore() != &websiteDataStore)
                 process->send(Messages::WebProcess::AddWebsiteDataStore(websiteDataStore.parameters()), 0);
@@ -1046,8 +1076,11 @@ void WebProcessPool::disconnectProcess(WebProcessProxy* process)
 {
     ASSERT(m_processes.contains(process));
 
-    if (process->isInPrewarmedPool())
+    if (process->isInPrewarmedPool()) {
         --m_prewarmedProcessCount;
+        ++m_prewarmedProcessStatistics.wastedProcessCount;
+        m_prewarmedProcessStatistics.wastedPrewarmTime += MonotonicTime::now() - process->prewarmedTime();
+    }
 
     // FIXME (Multi-WebProcess): <rdar://problem/12239765> Some of the invalidation calls of the other supplements are still necessary in multi-process mode, but they should only affect data structures pertaining to the process being disconnected.
     // Clearing everything causes assertion failures, so it's less trouble to skip that for now.
@@ -1296,13 +1329,67 @@ void WebProcessPool::postMessageToInjectedBundle(const String& messageName, API:
 
 void WebProcessPool::didReachGoodTimeToPrewarm()
 {
-    if (!m_configuration->processSwapsOnNavigation())
+    updatePrewarmedProcessPool();
+}
+
+bool WebProcessPool::isPrewarmingEnabled() const
+{
+    // Process swapping on navigation always wants a prewarmed process; other clients opt in by allowing more than one.
+    return m_configuration->processSwapsOnNavigation() || m_configuration->maximumPrewarmedProcessCount() > 1;
+}
+
+unsigned WebProcessPool::prewarmedProcessTargetCount(MonotonicTime now)
+{
+    while (!m_prewarmedProcessRequestTimes.isEmpty() && now - m_prewarmedProcessRequestTimes.first() > prewarmedProcessDemandWindow)
+        m_prewarmedProcessRequestTimes.removeFirst();
+
+    // Expect as many processes to be requested in the near future as were requested in the recent past.
+    unsigned minimumCount = m_configuration->minimumPrewarmedProcessCount();
+    unsigned maximumCount = std::max(minimumCount, m_configuration->maximumPrewarmedProcessCount());
+    unsigned demand = m_prewarmedProcessRequestTimes.size();
+    return std::min(std::max(demand, minimumCount), maximumCount);
+}
+
+void WebProcessPool::updatePrewarmedProcessPool()
+{
+    if (!isPrewarmingEnabled())
         return;
-    if (!m_websiteDataStore)
-        m_websiteDataStore = API::WebsiteDataStore::defaultDataStore().ptr();
-    static constexpr size_t maxPrewarmCount = 1;
-    while (m_prewarmedProcessCount < maxPrewarmCount)
-        createNewWebProcess(m_websiteDataStore->websiteDataStore(), WebProcessProxy::IsInPrewarmedPool::Yes);
+
+    unsigned targetCount = prewarmedProcessTargetCount(MonotonicTime::now());
+
+    Seconds idleTimeout = m_configuration->prewarmedProcessIdleTimeout();
+    if (idleTimeout)
+        shrinkPrewarmedProcessPool(targetCount, idleTimeout);
+
+    if (m_prewarmedProcessCount < targetCount) {
+        if (!m_websiteDataStore)
+            m_websiteDataStore = API::WebsiteDataStore::defaultDataStore().ptr();
+        while (m_prewarmedProcessCount < targetCount)
+            createNewWebProcess(m_websiteDataStore->websiteDataStore(), WebProcessProxy::IsInPrewarmedPool::Yes);
+    }
+
+    if (idleTimeout && m_prewarmedProcessCount > m_configuration->minimumPrewarmedProcessCount())
+        m_prewarmedProcessPoolTimer.startOneShot(idleTimeout);
+}
+
+void WebProcessPool::shrinkPrewarmedProcessPool(unsigned targetCount, Seconds minimumIdleTime)
+{
+    if (m_prewarmedProcessCount <= targetCount)
+        return;
+
+    // m_processes is in creation order, so the processes that have been idle the longest go first.
+    auto now = MonotonicTime::now();
+    Vector<RefPtr<WebProcessProxy>> processesToTerminate;
+    for (auto& process : m_processes) {
+        if (process->isInPrewarmedPool() && now - process->prewarmedTime() >= minimumIdleTime)
+            processesToTerminate.append(process);
+    }
+
+    for (auto& process : processesToTerminate) {
+        if (m_prewarmedProcessCount <= targetCount)
+            break;
+        process->requestTermination(ProcessTerminationReason::RequestedByClient);
+    }
 }
 
 void WebProcessPool::populateVisitedLinks()
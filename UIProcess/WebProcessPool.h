@@ -48,9 +48,11 @@
 #include <WebCore/SecurityOriginHash.h>
 #include <WebCore/SharedStringHash.h>
 #include <pal/SessionID.h>
+#include <wtf/Deque.h>
 #include <wtf/Forward.h>
 #include <wtf/HashMap.h>
 #include <wtf/HashSet.h>
+#include <wtf/MonotonicTime.h>
 #include <wtf/ProcessID.h>
 #include <wtf/RefCounter.h>
 #include <wtf/RefPtr.h>
@@ -473,6 +475,10 @@ private:
     Ref<WebProcessProxy> processForNavigationInternal(WebPageProxy&, const API::Navigation&, WebCore::PolicyAction&);
 
     RefPtr<WebProcessProxy> tryTakePrewarmedProcess(WebsiteDataStore&);
+    bool isPrewarmingEnabled() const;
+    unsigned prewarmedProcessTargetCount(MonotonicTime);
+    void updatePrewarmedProcessPool();
+    void shrinkPrewarmedProcessPool(unsigned targetCount, Seconds minimumIdleTime = 0_s);
 
     WebProcessProxy& createNewWebProcess(WebsiteDataStore&, WebProcessProxy::IsInPrewarmedPool = WebProcessProxy::IsInPrewarmedPool::No);
     void initializeNewWebProcess(WebProcessProxy&, WebsiteDataStore&);
@@ -538,6 +544,14 @@ private:
 
     Vector<RefPtr<WebProcessProxy>> m_processes;
     unsigned m_prewarmedProcessCount { 0 };
+    Deque<MonotonicTime> m_prewarmedProcessRequestTimes;
+    struct PrewarmedProcessStatistics {
+        uint64_t hitCount { 0 };
+        uint64_t missCount { 0 };
+        uint64_t wastedProcessCount { 0 };
+        Seconds wastedPrewarmTime;
+    };
+    PrewarmedProcessStatistics m_prewarmedProcessStatistics;
 
     WebProcessProxy* m_processWithPageCache { nullptr };
 #if ENABLE(SERVICE_WORKER)
@@ -694,6 +708,7 @@ private:
 
     HashMap<PAL::SessionID, HashSet<WebPageProxy*>> m_sessionToPagesMap;
     RunLoop::Timer<WebProcessPool> m_serviceWorkerProcessesTerminationTimer;
+    RunLoop::Timer<WebProcessPool> m_prewarmedProcessPoolTimer;
 
 #if PLATFORM(IOS)
     ForegroundWebProcessCounter m_foregroundWebProcessCounter;
@@ -139,6 +139,7 @@ WebProcessProxy::WebProcessProxy(WebProcessPool& processPool, WebsiteDataStore&
     , m_userMediaCaptureManagerProxy(std::make_unique<UserMediaCaptureManagerProxy>(*this))
 #endif
     , m_isInPrewarmedPool(isInPrewarmedPool == IsInPrewarmedPool::Yes)
+    , m_prewarmedTime(m_isInPrewarmedPool ? MonotonicTime::now() : MonotonicTime())
 {
     RELEASE_ASSERT(isMainThreadOrCheckDisabled());
 
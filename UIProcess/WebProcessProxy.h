@@ -47,6 +47,7 @@
 #include <wtf/Forward.h>
 #include <wtf/HashMap.h>
 #include <wtf/HashSet.h>
+#include <wtf/MonotonicTime.h>
 #include <wtf/RefCounted.h>
 #include <wtf/RefPtr.h>
 
@@ -220,6 +221,7 @@ public:
 
     bool isInPrewarmedPool() const { return m_isInPrewarmedPool; }
     void setIsInPrewarmedPool(bool isInPrewarmedPool) { m_isInPrewarmedPool = isInPrewarmedPool; }
+    MonotonicTime prewarmedTime() const { return m_prewarmedTime; }
 
 #if PLATFORM(COCOA)
     Vector<String> mediaMIMETypes();
@@ -360,6 +362,7 @@ private:
 
     bool m_hasCommittedAnyProvisionalLoads { false };
     bool m_isInPrewarmedPool;
+    MonotonicTime m_prewarmedTime;
 
 #if PLATFORM(WATCHOS)
     ProcessThrottler::BackgroundActivityToken m_backgroundActivityTokenForFullscreenFormControls;
@@ -29,6 +29,7 @@
 #if ENABLE(SERVICE_WORKER)
 
 #include "DataReference.h"
+#include "WebErrors.h"
 #include "WebSWClientConnection.h"
 #include "WebServiceWorkerProvider.h"
 #include <WebCore/CrossOriginAccessControl.h>
@@ -186,6 +187,24 @@ void ServiceWorkerClientFetch::didReceiveData(const IPC::DataReference& dataRefe
     });
 }
 
+void ServiceWorkerClientFetch::didReceiveSharedData(const SharedMemory::Handle& handle, uint64_t offset, uint64_t size, int64_t encodedDataLength)
+{
+    if (m_didFail)
+        return;
+
+    // A null handle means the data was appended to the region we already have mapped.
+    if (!handle.isNull())
+        m_sharedData = SharedMemory::map(handle, SharedMemory::Protection::ReadOnly);
+
+    if (!m_sharedData || offset > m_sharedData->size() || size > m_sharedData->size() - offset) {
+        m_sharedData = nullptr;
+        didFail(internalError(m_loader ? m_loader->request().url() : URL { }));
+        return;
+    }
+
+    didReceiveData({ static_cast<const uint8_t*>(m_sharedData->data()) + offset, static_cast<size_t>(size) }, encodedDataLength);
+}
+
 void ServiceWorkerClientFetch::didReceiveFormData(const IPC::FormDataReference&)
 {
     // FIXME: Implement form data reading.
@@ -194,6 +213,7 @@ void ServiceWorkerClientFetch::didReceiveFormData(const IPC::FormDataReference&)
 void ServiceWorkerClientFetch::didFinish()
 {
     m_didFinish = true;
+    m_sharedData = nullptr;
 
     if (m_isCheckingResponse)
         return;
@@ -227,6 +247,7 @@ void ServiceWorkerClientFetch::didFail(ResourceError&& error)
 {
     m_didFail = true;
     m_error = WTFMove(error);
+    m_sharedData = nullptr;
 
     if (m_isCheckingResponse)
         return;
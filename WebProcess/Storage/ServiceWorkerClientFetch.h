@@ -31,6 +31,7 @@
 #include "FormDataReference.h"
 #include "MessageReceiver.h"
 #include "MessageSender.h"
+#include "SharedMemory.h"
 #include <WebCore/FetchIdentifier.h>
 #include <WebCore/ResourceError.h>
 #include <WebCore/ResourceLoader.h>
@@ -63,6 +64,7 @@ private:
 
     void didReceiveResponse(WebCore::ResourceResponse&&);
     void didReceiveData(const IPC::DataReference&, int64_t encodedDataLength);
+    void didReceiveSharedData(const SharedMemory::Handle&, uint64_t offset, uint64_t size, int64_t encodedDataLength);
     void didReceiveFormData(const IPC::FormDataReference&);
     void didFinish();
     void didFail(WebCore::ResourceError&&);
@@ -80,6 +82,8 @@ private:
     bool m_shouldClearReferrerOnHTTPSToHTTPRedirect { true };
     RefPtr<WebCore::SharedBuffer> m_buffer;
     int64_t m_encodedDataLength { 0 };
+    // The service worker process appends large chunks to this region until it is full.
+    RefPtr<SharedMemory> m_sharedData;
     bool m_isCheckingResponse { false };
     bool m_didFinish { false };
     bool m_didFail { false };
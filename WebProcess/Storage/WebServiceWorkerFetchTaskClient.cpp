@@ -42,6 +42,12 @@ using namespace WebCore;
 
 namespace WebKit {
 
+// Smaller chunks are cheaper to copy through the StorageProcess than to map.
+static const size_t minimumSharedMemoryDataSize = 32 * 1024;
+// Chunks are appended to a region of this size so that allocating, passing and mapping a region is paid
+// once per megabyte of body rather than once per chunk. Pages that are never written are never committed.
+static const size_t sharedMemoryDataRegionSize = 1024 * 1024;
+
 WebServiceWorkerFetchTaskClient::~WebServiceWorkerFetchTaskClient()
 {
     if (m_connection)
@@ -63,10 +69,41 @@ void WebServiceWorkerFetchTaskClient::didReceiveResponse(const ResourceResponse&
     m_connection->send(Messages::StorageProcess::DidReceiveFetchResponse { m_serverConnectionIdentifier, m_fetchIdentifier, response }, 0);
 }
 
+bool WebServiceWorkerFetchTaskClient::sendDataThroughSharedMemory(size_t size, const WTF::Function<void(uint8_t*)>& copyData)
+{
+    if (size < minimumSharedMemoryDataSize)
+        return false;
+
+    // The region is never rewritten, so the client can read any chunk until it is told about the next region.
+    SharedMemory::Handle handle;
+    if (!m_sharedData || size > m_sharedData->size() - m_sharedDataOffset) {
+        auto sharedData = SharedMemory::allocate(std::max(size, sharedMemoryDataRegionSize));
+        if (!sharedData || !sharedData->createHandle(handle, SharedMemory::Protection::ReadOnly))
+            return false;
+        m_sharedData = WTFMove(sharedData);
+        m_sharedDataOffset = 0;
+    }
+
+    copyData(static_cast<uint8_t*>(m_sharedData->data()) + m_sharedDataOffset);
+    m_connection->send(Messages::StorageProcess::DidReceiveFetchSharedData { m_serverConnectionIdentifier, m_fetchIdentifier, handle, static_cast<uint64_t>(m_sharedDataOffset), static_cast<uint64_t>(size), static_cast<int64_t>(size) }, 0);
+    m_sharedDataOffset += size;
+    return true;
+}
+
 void WebServiceWorkerFetchTaskClient::didReceiveData(Ref<SharedBuffer>&& buffer)
 {
     if (!m_connection)
         return;
+
+    bool didSend = sendDataThroughSharedMemory(buffer->size(), [&buffer](uint8_t* data) {
+        for (const auto& element : buffer.get()) {
+            memcpy(data, element.segment->data(), element.segment->size());
+            data += element.segment->size();
+        }
+    });
+    if (didSend)
+        return;
+
     IPC::SharedBufferDataReference dataReference { buffer.ptr() };
     m_connection->send(Messages::StorageProcess::DidReceiveFetchData { m_serverConnectionIdentifier, m_fetchIdentifier, dataReference, static_cast<int64_t>(buffer->size()) }, 0);
 }
@@ -108,6 +145,12 @@ void WebServiceWorkerFetchTaskClient::didReceiveBlobChunk(const char* data, size
     if (!m_connection)
         return;
 
+    bool didSend = sendDataThroughSharedMemory(size, [data, size](uint8_t* sharedData) {
+        memcpy(sharedData, data, size);
+    });
+    if (didSend)
+        return;
+
     IPC::DataReference dataReference { reinterpret_cast<const uint8_t*>(data), size };
     m_connection->send(Messages::StorageProcess::DidReceiveFetchData { m_serverConnectionIdentifier, m_fetchIdentifier, dataReference, static_cast<int64_t>(size) }, 0);
 }
@@ -157,6 +200,7 @@ void WebServiceWorkerFetchTaskClient::cancel()
 void WebServiceWorkerFetchTaskClient::cleanup()
 {
     m_connection = nullptr;
+    m_sharedData = nullptr;
 
     if (!isMainThread()) {
         callOnMainThread([protectedThis = makeRef(*this)] () {
@@ -28,6 +28,7 @@
 #if ENABLE(SERVICE_WORKER)
 
 #include "Connection.h"
+#include "SharedMemory.h"
 #include <WebCore/FetchIdentifier.h>
 #include <WebCore/FetchLoader.h>
 #include <WebCore/FetchLoaderClient.h>
@@ -57,6 +58,7 @@ private:
     void cancel() final;
 
     void cleanup();
+    bool sendDataThroughSharedMemory(size_t, const WTF::Function<void(uint8_t*)>& copyData);
     
     void didReceiveBlobChunk(const char* data, size_t size);
     void didFinishBlobLoading();
@@ -79,6 +81,9 @@ private:
     WebCore::ServiceWorkerIdentifier m_serviceWorkerIdentifier;
     WebCore::FetchIdentifier m_fetchIdentifier;
     std::optional<BlobLoader> m_blobLoader;
+    // Large chunks are appended to this region, which the client keeps mapped, until it is full.
+    RefPtr<SharedMemory> m_sharedData;
+    size_t m_sharedDataOffset { 0 };
 };
 
 } // namespace WebKit
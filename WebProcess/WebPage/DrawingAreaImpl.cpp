@@ -29,6 +29,7 @@
 #include "DrawingAreaProxyMessages.h"
 #include "LayerTreeHost.h"
 #include "ShareableBitmap.h"
+#include "SharedMemory.h"
 #include "UpdateInfo.h"
 #include "WebPage.h"
 #include "WebPageCreationParameters.h"
@@ -36,6 +37,18 @@
 #include <WebCore/GraphicsContext.h>
 #include <WebCore/Page.h>
 #include <WebCore/Settings.h>
+#include <wtf/MathExtras.h>
+
+#if USE(CAIRO)
+#include <WebCore/GraphicsContextImplCairo.h>
+#include <WebCore/RefPtrCairo.h>
+#include <cairo.h>
+#include <wtf/NumberOfCores.h>
+#if CAIRO_HAS_TEE_SURFACE
+#include <cairo-tee.h>
+#endif
+#include <wtf/WorkQueue.h>
+#endif
 
 #if USE(GLIB_EVENT_LOOP)
 #include <wtf/glib/RunLoopSourcePriority.h>
@@ -180,6 +193,7 @@ void DrawingAreaImpl::updatePreferences(const WebPreferencesStore& store)
 #endif
 
     m_alwaysUseCompositing = settings.acceleratedCompositingEnabled() && settings.forceCompositingMode();
+    m_parallelPaintingEnabled = store.getBoolValueForKey(WebPreferencesKey::parallelPaintingEnabledKey());
     if (m_alwaysUseCompositing && !m_layerTreeHost)
         enterAcceleratedCompositingMode(nullptr);
 }
@@ -253,6 +267,8 @@ void DrawingAreaImpl::sendDidUpdateBackingStoreState()
 
 void DrawingAreaImpl::didUpdate()
 {
+    ++m_acknowledgedUpdateCount;
+
     // We might get didUpdate messages from the UI process even after we've
     // entered accelerated compositing mode. Ignore them.
     if (m_layerTreeHost)
@@ -268,6 +284,7 @@ void DrawingAreaImpl::suspendPainting()
 {
     AcceleratedDrawingArea::suspendPainting();
     m_displayTimer.stop();
+    m_frameBuffers.clear();
 }
 
 void DrawingAreaImpl::enterAcceleratedCompositingMode(GraphicsLayer* graphicsLayer)
@@ -280,6 +297,7 @@ void DrawingAreaImpl::enterAcceleratedCompositingMode(GraphicsLayer* graphicsLay
     m_scrollOffset = IntSize();
     m_displayTimer.stop();
     m_isWaitingForDidUpdate = false;
+    m_frameBuffers.clear();
 }
 
 void DrawingAreaImpl::exitAcceleratedCompositingMode()
@@ -313,7 +331,7 @@ void DrawingAreaImpl::exitAcceleratedCompositingMode()
     } else {
         // If we left accelerated compositing mode before we sent an EnterAcceleratedCompositingMode message to the
         // UI process, we still need to let it know about the new contents, so send an Update message.
-        m_webPage.send(Messages::DrawingAreaProxy::Update(m_backingStoreStateID, updateInfo));
+        sendUpdate(updateInfo);
     }
 }
 
@@ -367,10 +385,18 @@ void DrawingAreaImpl::display()
         return;
     }
 
-    m_webPage.send(Messages::DrawingAreaProxy::Update(m_backingStoreStateID, updateInfo));
+    sendUpdate(updateInfo);
     m_isWaitingForDidUpdate = true;
 }
 
+void DrawingAreaImpl::sendUpdate(const UpdateInfo& updateInfo)
+{
+    // The UI process acknowledges every Update message, and the frame buffer picked in display() is
+    // released by counting those acknowledgements, so all Update messages have to be sent from here.
+    m_webPage.send(Messages::DrawingAreaProxy::Update(m_backingStoreStateID, updateInfo));
+    ++m_sentUpdateCount;
+}
+
 static bool shouldPaintBoundsRect(const IntRect& bounds, const Vector<IntRect>& rects)
 {
     const size_t rectThreshold = 10;
@@ -392,6 +418,172 @@ static bool shouldPaintBoundsRect(const IntRect& bounds, const Vector<IntRect>&
     return wastedSpace <= wastedSpaceThreshold;
 }
 
+static size_t frameBufferSizeClass(size_t numBytes)
+{
+    // Small updates get power of two buffers and large ones are rounded up to whole megabytes,
+    // so that damage of a similar size keeps landing in the same buffer.
+    const size_t largeFrameBufferSize = 1024 * 1024;
+    if (numBytes >= largeFrameBufferSize)
+        return roundUpToMultipleOf(largeFrameBufferSize, numBytes);
+    return std::max<size_t>(roundUpToPowerOfTwo(numBytes), SharedMemory::systemPageSize());
+}
+
+RefPtr<ShareableBitmap> DrawingAreaImpl::createFrameBufferBitmap(const IntSize& size, UpdateInfo& updateInfo)
+{
+    auto numBytes = ShareableBitmap::numBytesForSize(size, { });
+    if (numBytes.hasOverflowed())
+        return nullptr;
+
+    // Use the smallest frame buffer that is large enough and that the UI process is done with.
+    std::optional<size_t> slot;
+    std::optional<size_t> freeSlot;
+    for (size_t i = 0; i < m_frameBuffers.size(); ++i) {
+        auto& frameBuffer = m_frameBuffers[i];
+        if (frameBuffer.releaseUpdateCount > m_acknowledgedUpdateCount)
+            continue;
+        if (!freeSlot)
+            freeSlot = i;
+        if (frameBuffer.sharedMemory->size() < numBytes.unsafeGet())
+            continue;
+        if (!slot || frameBuffer.sharedMemory->size() < m_frameBuffers[*slot].sharedMemory->size())
+            slot = i;
+    }
+
+    if (!slot) {
+        if (m_frameBuffers.size() < UpdateInfo::maximumFrameBufferCount)
+            slot = m_frameBuffers.size();
+        else
+            slot = freeSlot;
+
+        if (!slot) {
+            // Every frame buffer is still in use by the UI process.
+            RefPtr<ShareableBitmap> bitmap = ShareableBitmap::createShareable(size, { });
+            if (!bitmap || !bitmap->createHandle(updateInfo.bitmapHandle))
+                return nullptr;
+            return bitmap;
+        }
+
+        auto sharedMemory = SharedMemory::allocate(frameBufferSizeClass(numBytes.unsafeGet()));
+        if (!sharedMemory)
+            return nullptr;
+
+        if (*slot == m_frameBuffers.size())
+            m_frameBuffers.append(FrameBuffer { WTFMove(sharedMemory) });
+        else
+            m_frameBuffers[*slot] = FrameBuffer { WTFMove(sharedMemory) };
+    }
+
+    auto& frameBuffer = m_frameBuffers[*slot];
+    RefPtr<ShareableBitmap> bitmap = ShareableBitmap::create(size, { }, frameBuffer.sharedMemory);
+    if (!bitmap)
+        return nullptr;
+
+    if (!frameBuffer.isMappedInUIProcess) {
+        if (!bitmap->createHandle(updateInfo.bitmapHandle))
+            return nullptr;
+        frameBuffer.isMappedInUIProcess = true;
+    }
+
+    // Messages other than Update are not acknowledged, so they hold on to the buffer until the next Update is.
+    frameBuffer.releaseUpdateCount = m_sentUpdateCount + 1;
+    updateInfo.frameBufferSlot = *slot;
+    return bitmap;
+}
+
+void DrawingAreaImpl::paintRects(ShareableBitmap& bitmap, const IntRect& bounds, const Vector<IntRect>& rects, float deviceScaleFactor)
+{
+    auto graphicsContext = bitmap.createGraphicsContext();
+    graphicsContext->applyDeviceScaleFactor(deviceScaleFactor);
+    graphicsContext->translate(-bounds.x(), -bounds.y());
+
+    for (const auto& rect : rects) {
+        // Frame buffers are recycled, so clear whatever the previous update left there.
+        graphicsContext->clearRect(rect);
+        m_webPage.drawRect(*graphicsContext, rect);
+    }
+}
+
+#if USE(CAIRO)
+void DrawingAreaImpl::paintRectsInParallel(ShareableBitmap& bitmap, const IntRect& bounds, const Vector<IntRect>& rects, float deviceScaleFactor)
+{
+#if CAIRO_HAS_TEE_SURFACE
+    const int minimumBandHeight = 128;
+
+    IntSize bitmapSize = bitmap.size();
+    Vector<IntRect> deviceRects;
+    deviceRects.reserveInitialCapacity(rects.size());
+    for (const auto& rect : rects) {
+        FloatRect scaledRect(rect);
+        scaledRect.moveBy(-bounds.location());
+        scaledRect.scale(deviceScaleFactor);
+        deviceRects.uncheckedAppend(intersection(enclosingIntRect(scaledRect), IntRect(IntPoint(), bitmapSize)));
+    }
+
+    // The bitmap is split in horizontal bands, one per worker. Bands don't overlap, so workers never write to the same pixels.
+    int bandCount = std::max(1, std::min(static_cast<int>(WTF::numberOfProcessorCores()), bitmapSize.height() / minimumBandHeight));
+    int bandHeight = (bitmapSize.height() + bandCount - 1) / bandCount;
+    Vector<IntRect> bands;
+    for (int y = 0; y < bitmapSize.height(); y += bandHeight) {
+        IntRect band(0, y, bitmapSize.width(), std::min(bandHeight, bitmapSize.height() - y));
+        if (deviceRects.findMatching([&band](const IntRect& deviceRect) { return deviceRect.intersects(band); }) != notFound)
+            bands.append(band);
+    }
+
+    if (bands.size() < 2) {
+        paintRects(bitmap, bounds, rects, deviceScaleFactor);
+        return;
+    }
+
+    // The page is painted once, into a tee surface that forwards the drawing to one recording per band. cairo
+    // recordings are not safe to replay concurrently, so every worker replays its own copy.
+    cairo_rectangle_t extents = { 0, 0, static_cast<double>(bitmapSize.width()), static_cast<double>(bitmapSize.height()) };
+    Vector<RefPtr<cairo_surface_t>> recordingSurfaces;
+    recordingSurfaces.reserveInitialCapacity(bands.size());
+    for (size_t i = 0; i < bands.size(); ++i)
+        recordingSurfaces.uncheckedAppend(adoptRef(cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, &extents)));
+
+    {
+        RefPtr<cairo_surface_t> teeSurface = adoptRef(cairo_tee_surface_create(recordingSurfaces[0].get()));
+        for (size_t i = 1; i < recordingSurfaces.size(); ++i)
+            cairo_tee_surface_add(teeSurface.get(), recordingSurfaces[i].get());
+
+        RefPtr<cairo_t> recordingContext = adoptRef(cairo_create(teeSurface.get()));
+        GraphicsContext graphicsContext(GraphicsContextImplCairo::createFactory(recordingContext.get()));
+        graphicsContext.applyDeviceScaleFactor(deviceScaleFactor);
+        graphicsContext.translate(-bounds.x(), -bounds.y());
+        for (const auto& rect : rects)
+            m_webPage.drawRect(graphicsContext, rect);
+    }
+
+    RefPtr<cairo_surface_t> bitmapSurface = bitmap.createCairoSurface();
+    unsigned char* data = cairo_image_surface_get_data(bitmapSurface.get());
+    int stride = cairo_image_surface_get_stride(bitmapSurface.get());
+    cairo_format_t format = cairo_image_surface_get_format(bitmapSurface.get());
+
+    WorkQueue::concurrentApply(bands.size(), [&](size_t index) {
+        const IntRect& bandRect = bands[index];
+        RefPtr<cairo_surface_t> bandSurface = adoptRef(cairo_image_surface_create_for_data(data + bandRect.y() * stride, format, bandRect.width(), bandRect.height(), stride));
+        RefPtr<cairo_t> context = adoptRef(cairo_create(bandSurface.get()));
+
+        for (const auto& deviceRect : deviceRects) {
+            IntRect clipRect = intersection(deviceRect, bandRect);
+            if (!clipRect.isEmpty())
+                cairo_rectangle(context.get(), clipRect.x(), clipRect.y() - bandRect.y(), clipRect.width(), clipRect.height());
+        }
+        cairo_clip(context.get());
+
+        // The recording is transparent wherever nothing was drawn, so copying it also clears the recycled frame buffer.
+        cairo_set_operator(context.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(context.get(), recordingSurfaces[index].get(), 0, -bandRect.y());
+        cairo_paint(context.get());
+    });
+#else
+    // Without tee surfaces a recording can't be copied, so there is nothing safe to hand to the workers.
+    paintRects(bitmap, bounds, rects, deviceScaleFactor);
+#endif
+}
+#endif
+
 void DrawingAreaImpl::display(UpdateInfo& updateInfo)
 {
     ASSERT(!m_isPaintingSuspended);
@@ -416,13 +608,10 @@ void DrawingAreaImpl::display(UpdateInfo& updateInfo)
     IntSize bitmapSize = bounds.size();
     float deviceScaleFactor = m_webPage.corePage()->deviceScaleFactor();
     bitmapSize.scale(deviceScaleFactor);
-    RefPtr<ShareableBitmap> bitmap = ShareableBitmap::createShareable(bitmapSize, { });
+    RefPtr<ShareableBitmap> bitmap = createFrameBufferBitmap(bitmapSize, updateInfo);
     if (!bitmap)
         return;
 
-    if (!bitmap->createHandle(updateInfo.bitmapHandle))
-        return;
-
     Vector<IntRect> rects;
     if (m_webPage.drawsBackground()) {
         rects = m_dirtyRegion.rects();
@@ -441,17 +630,18 @@ void DrawingAreaImpl::display(UpdateInfo& updateInfo)
     m_scrollRect = IntRect();
     m_scrollOffset = IntSize();
 
-    auto graphicsContext = bitmap->createGraphicsContext();
-    graphicsContext->applyDeviceScaleFactor(deviceScaleFactor);
-    
     updateInfo.updateRectBounds = bounds;
 
-    graphicsContext->translate(-bounds.x(), -bounds.y());
+#if USE(CAIRO)
+    // Only split up updates that are large enough for the recording overhead to pay off.
+    const uint64_t minimumParallelPaintingArea = 512 * 512;
+    if (m_parallelPaintingEnabled && static_cast<uint64_t>(bitmapSize.width()) * bitmapSize.height() >= minimumParallelPaintingArea)
+        paintRectsInParallel(*bitmap, bounds, rects, deviceScaleFactor);
+    else
+#endif
+        paintRects(*bitmap, bounds, rects, deviceScaleFactor);
 
-    for (const auto& rect : rects) {
-        m_webPage.drawRect(*graphicsContext, rect);
-        updateInfo.updateRects.append(rect);
-    }
+    updateInfo.updateRects = WTFMove(rects);
 
     // Layout can trigger more calls to setNeedsDisplay and we don't want to process them
     // until the UI process has painted the update, so we stop the timer here.
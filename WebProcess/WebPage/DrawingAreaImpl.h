@@ -35,6 +35,7 @@ class GraphicsContext;
 namespace WebKit {
 
 class ShareableBitmap;
+class SharedMemory;
 class UpdateInfo;
 
 class DrawingAreaImpl final : public AcceleratedDrawingArea {
@@ -69,6 +70,12 @@ private:
     void displayTimerFired();
     void display();
     void display(UpdateInfo&);
+    void sendUpdate(const UpdateInfo&);
+    RefPtr<ShareableBitmap> createFrameBufferBitmap(const WebCore::IntSize&, UpdateInfo&);
+    void paintRects(ShareableBitmap&, const WebCore::IntRect& bounds, const Vector<WebCore::IntRect>&, float deviceScaleFactor);
+#if USE(CAIRO)
+    void paintRectsInParallel(ShareableBitmap&, const WebCore::IntRect& bounds, const Vector<WebCore::IntRect>&, float deviceScaleFactor);
+#endif
 
     WebCore::Region m_dirtyRegion;
     WebCore::IntRect m_scrollRect;
@@ -79,9 +86,21 @@ private:
     bool m_isWaitingForDidUpdate { false };
 
     bool m_alwaysUseCompositing {false };
+    bool m_parallelPaintingEnabled { false };
     bool m_forceRepaintAfterBackingStoreStateUpdate { false };
 
     RunLoop::Timer<DrawingAreaImpl> m_displayTimer;
+
+    // Shared memory the updates are painted into. A frame buffer is reused once the UI process has
+    // acknowledged the Update message that was sent with it, or with any update before it.
+    struct FrameBuffer {
+        RefPtr<SharedMemory> sharedMemory;
+        uint64_t releaseUpdateCount { 0 };
+        bool isMappedInUIProcess { false };
+    };
+    Vector<FrameBuffer> m_frameBuffers;
+    uint64_t m_sentUpdateCount { 0 };
+    uint64_t m_acknowledgedUpdateCount { 0 };
 };
 
 } // namespace WebKit
@@ -103,6 +103,14 @@
 #endif
 #endif
 
+#ifndef ENABLE_NETWORK_CACHE_COMPRESSION
+#if USE(SOUP)
+#define ENABLE_NETWORK_CACHE_COMPRESSION 1
+#else
+#define ENABLE_NETWORK_CACHE_COMPRESSION 0
+#endif
+#endif
+
 #ifndef HAVE_SAFARI_SERVICES_FRAMEWORK
 #if PLATFORM(IOS) && (!defined TARGET_OS_IOS || TARGET_OS_IOS) && !PLATFORM(IOSMAC)
 #define HAVE_SAFARI_SERVICES_FRAMEWORK 1